@@ -0,0 +1,749 @@
+/*
+	Copyright(C) 2016, Red Hat, Inc., Stanislav Kozina
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Single file (tar) storage of the kABI records
+ *
+ * The archives are written in the POSIX ustar format, names longer than
+ * the ustar name field use a pax extended header. Compression is done by
+ * piping the archive through the zstd program.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "archive.h"
+#include "buffer.h"
+#include "hash.h"
+#include "utils.h"
+
+#define TAR_BLOCK 512
+#define TAR_NAME_LEN 100
+#define ARCHIVE_FLUSH_SIZE (1024 * 1024)
+#define ARCHIVE_HASH_SIZE 4096
+/* Smaller files are read, mapping them costs more than copying them */
+#define KABI_MMAP_MIN (256 * 1024)
+
+static const unsigned char zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+struct tar_header {
+	char name[100];
+	char mode[8];
+	char uid[8];
+	char gid[8];
+	char size[12];
+	char mtime[12];
+	char chksum[8];
+	char typeflag;
+	char linkname[100];
+	char magic[6];
+	char version[2];
+	char uname[32];
+	char gname[32];
+	char devmajor[8];
+	char devminor[8];
+	char prefix[155];
+	char pad[12];
+};
+
+struct archive_writer {
+	char *path;
+	int fd;		/* the archive or the pipe to zstd */
+	pid_t zstd;	/* zstd process or 0 */
+	struct buffer buf;
+};
+
+struct archive_member {
+	char *name;
+	const char *data;
+	size_t size;
+};
+
+struct archive {
+	char *path;
+	struct buffer raw;
+	struct archive_member *members;
+	size_t count;
+	struct hash *names;
+};
+
+static bool has_suffix(const char *s, const char *suffix)
+{
+	size_t len = strlen(s);
+	size_t slen = strlen(suffix);
+
+	return len >= slen && strcmp(s + len - slen, suffix) == 0;
+}
+
+bool is_archive(const char *path)
+{
+	return has_suffix(path, ".tar") || has_suffix(path, ".tar.zst");
+}
+
+/*
+ * Order the member names the way walk_dir() lists the files: in each
+ * directory, the regular files first, then the subdirectories.
+ */
+int archive_name_cmp(const char *name1, const char *name2)
+{
+	for (;;) {
+		const char *end1 = strchr(name1, '/');
+		const char *end2 = strchr(name2, '/');
+		size_t len1 = end1 ? (size_t)(end1 - name1) : strlen(name1);
+		size_t len2 = end2 ? (size_t)(end2 - name2) : strlen(name2);
+		size_t len = len1 < len2 ? len1 : len2;
+		int ret;
+
+		if (end1 == NULL && end2 != NULL)
+			return -1;
+		if (end1 != NULL && end2 == NULL)
+			return 1;
+
+		ret = memcmp(name1, name2, len);
+		if (ret != 0)
+			return ret;
+		if (len1 != len2)
+			return len1 < len2 ? -1 : 1;
+		if (end1 == NULL)
+			return 0;
+
+		name1 = end1 + 1;
+		name2 = end2 + 1;
+	}
+}
+
+/* Run zstd with the given standard input and output */
+static pid_t zstd_spawn(const char *mode, int in, int out)
+{
+	pid_t pid = fork();
+
+	if (pid < 0)
+		fail("Cannot run zstd: %s\n", strerror(errno));
+
+	if (pid == 0) {
+		if (dup2(in, STDIN_FILENO) < 0 ||
+		    dup2(out, STDOUT_FILENO) < 0)
+			_exit(127);
+		execlp("zstd", "zstd", "-q", mode, "-c", (char *)NULL);
+		_exit(127);
+	}
+
+	return pid;
+}
+
+static void zstd_wait(pid_t pid, const char *path)
+{
+	int status;
+
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR)
+			fail("Cannot wait for zstd: %s\n", strerror(errno));
+	}
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		fail("zstd failed on archive '%s'\n", path);
+}
+
+/*
+ * Archive writer
+ */
+
+struct archive_writer *archive_writer_open(const char *path)
+{
+	struct archive_writer *w = safe_zmalloc(sizeof(*w));
+	int fd;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (fd < 0)
+		fail("Cannot create archive '%s': %s\n", path, strerror(errno));
+
+	w->path = safe_strdup(path);
+	buffer_init(&w->buf);
+
+	if (has_suffix(path, ".zst")) {
+		int p[2];
+
+		if (pipe2(p, O_CLOEXEC) < 0)
+			fail("Cannot create pipe: %s\n", strerror(errno));
+		w->zstd = zstd_spawn("-z", p[0], fd);
+		close(p[0]);
+		close(fd);
+		fd = p[1];
+	}
+	w->fd = fd;
+
+	return w;
+}
+
+/*
+ * Write the buffer to the pipe to zstd with SIGPIPE blocked: a failing
+ * zstd is reported as a write error, without touching the handler of the
+ * signal.
+ */
+static int archive_writer_pipe(struct archive_writer *w)
+{
+	struct timespec zero = { 0, 0 };
+	sigset_t pipe_set, old_set, pending;
+	bool was_pending;
+	int ret, err;
+
+	sigemptyset(&pipe_set);
+	sigaddset(&pipe_set, SIGPIPE);
+	sigpending(&pending);
+	was_pending = sigismember(&pending, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+
+	ret = buffer_write(&w->buf, w->fd);
+	err = errno;
+
+	/* consume the SIGPIPE raised by the write */
+	if (ret < 0 && err == EPIPE && !was_pending) {
+		while (sigtimedwait(&pipe_set, NULL, &zero) < 0 &&
+		       errno == EINTR)
+			;
+	}
+	pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+	errno = err;
+
+	return ret;
+}
+
+static void archive_writer_flush(struct archive_writer *w)
+{
+	int ret;
+
+	if (w->zstd != 0)
+		ret = archive_writer_pipe(w);
+	else
+		ret = buffer_write(&w->buf, w->fd);
+	if (ret < 0)
+		fail("Cannot write archive '%s': %s\n", w->path,
+		     strerror(errno));
+	buffer_reset(&w->buf);
+}
+
+static void archive_writer_zero(struct archive_writer *w, size_t len)
+{
+	buffer_grow(&w->buf, len);
+	memset(w->buf.data + w->buf.len, 0, len);
+	w->buf.len += len;
+}
+
+/* Pad data of size len to a full block */
+static void archive_writer_pad(struct archive_writer *w, size_t len)
+{
+	archive_writer_zero(w, (TAR_BLOCK - len % TAR_BLOCK) % TAR_BLOCK);
+}
+
+static void archive_writer_header(struct archive_writer *w, const char *name,
+				  char typeflag, size_t size)
+{
+	struct tar_header h;
+	unsigned int sum = 0;
+	size_t i;
+
+	memset(&h, 0, sizeof(h));
+	/* not terminated if it fills it, longer names have a pax header */
+	memcpy(h.name, name, strnlen(name, sizeof(h.name)));
+	snprintf(h.mode, sizeof(h.mode), "%07o", 0644);
+	snprintf(h.uid, sizeof(h.uid), "%07o", 0);
+	snprintf(h.gid, sizeof(h.gid), "%07o", 0);
+	snprintf(h.size, sizeof(h.size), "%011zo", size);
+	snprintf(h.mtime, sizeof(h.mtime), "%011o", 0);
+	h.typeflag = typeflag;
+	memcpy(h.magic, "ustar", 6);
+	memcpy(h.version, "00", 2);
+
+	memset(h.chksum, ' ', sizeof(h.chksum));
+	for (i = 0; i < sizeof(h); i++)
+		sum += ((unsigned char *)&h)[i];
+	snprintf(h.chksum, sizeof(h.chksum), "%06o", sum);
+
+	buffer_put(&w->buf, (char *)&h, sizeof(h));
+}
+
+/* pax extended header carrying a name too long for the ustar header */
+static void archive_writer_long_name(struct archive_writer *w,
+				     const char *name)
+{
+	size_t len = strlen(" path=\n") + strlen(name);
+	size_t digits = 1, total;
+	char *record;
+
+	while (snprintf(NULL, 0, "%zu", len + digits) != (int)digits)
+		digits++;
+	total = len + digits;
+
+	safe_asprintf(&record, "%zu path=%s\n", total, name);
+	archive_writer_header(w, "PaxHeader", 'x', total);
+	buffer_put(&w->buf, record, total);
+	archive_writer_pad(w, total);
+	free(record);
+}
+
+void archive_writer_add(struct archive_writer *w, const char *name,
+			const char *data, size_t len)
+{
+	if (strlen(name) > TAR_NAME_LEN)
+		archive_writer_long_name(w, name);
+
+	archive_writer_header(w, name, '0', len);
+	buffer_put(&w->buf, data, len);
+	archive_writer_pad(w, len);
+
+	if (w->buf.len >= ARCHIVE_FLUSH_SIZE)
+		archive_writer_flush(w);
+}
+
+void archive_writer_close(struct archive_writer *w)
+{
+	/* end of archive: two zero blocks */
+	archive_writer_zero(w, 2 * TAR_BLOCK);
+	archive_writer_flush(w);
+
+	if (close(w->fd) < 0)
+		fail("Cannot close archive '%s': %s\n", w->path,
+		     strerror(errno));
+	if (w->zstd != 0)
+		zstd_wait(w->zstd, w->path);
+
+	buffer_free(&w->buf);
+	free(w->path);
+	free(w);
+}
+
+/*
+ * Archive reader
+ *
+ * The whole archive is loaded in memory and the members are read from
+ * there.
+ */
+
+static void read_all(int fd, struct buffer *buf, const char *path)
+{
+	for (;;) {
+		ssize_t n;
+
+		buffer_grow(buf, ARCHIVE_FLUSH_SIZE);
+		n = read(fd, buf->data + buf->len, buf->size - buf->len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			fail("Cannot read archive '%s': %s\n", path,
+			     strerror(errno));
+		}
+		if (n == 0)
+			break;
+		buf->len += n;
+	}
+}
+
+static void archive_load(struct archive *a)
+{
+	int fd;
+
+	fd = open(a->path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		fail("Cannot open archive '%s': %s\n", a->path,
+		     strerror(errno));
+
+	read_all(fd, &a->raw, a->path);
+
+	if (a->raw.len >= sizeof(zstd_magic) &&
+	    memcmp(a->raw.data, zstd_magic, sizeof(zstd_magic)) == 0) {
+		int p[2];
+		pid_t pid;
+
+		if (lseek(fd, 0, SEEK_SET) < 0)
+			fail("Cannot seek archive '%s': %s\n", a->path,
+			     strerror(errno));
+		if (pipe2(p, O_CLOEXEC) < 0)
+			fail("Cannot create pipe: %s\n", strerror(errno));
+
+		pid = zstd_spawn("-d", fd, p[1]);
+		close(p[1]);
+		buffer_reset(&a->raw);
+		read_all(p[0], &a->raw, a->path);
+		close(p[0]);
+		zstd_wait(pid, a->path);
+	}
+
+	close(fd);
+}
+
+static size_t parse_octal(const char *s, size_t len)
+{
+	size_t val = 0;
+
+	while (len > 0 && *s == ' ') {
+		s++;
+		len--;
+	}
+	while (len > 0 && *s >= '0' && *s <= '7') {
+		val = val * 8 + (*s - '0');
+		s++;
+		len--;
+	}
+
+	return val;
+}
+
+/* Extract the path record of a pax extended header */
+static char *pax_path(const char *data, size_t size)
+{
+	const char *end = data + size;
+
+	while (data < end) {
+		const char *rec = data;
+		size_t len = 0;
+		const char *kw;
+
+		while (data < end && *data >= '0' && *data <= '9')
+			len = len * 10 + (*data++ - '0');
+		if (len == 0 || rec + len > end)
+			break;
+
+		kw = data + 1;
+		if (strncmp(kw, "path=", 5) == 0)
+			return strndup(kw + 5, rec + len - 1 - (kw + 5));
+		data = rec + len;
+	}
+
+	return NULL;
+}
+
+static char *header_name(struct tar_header *h)
+{
+	char *name;
+
+	if (h->prefix[0] != '\0' && memcmp(h->magic, "ustar", 5) == 0)
+		safe_asprintf(&name, "%.*s/%.*s",
+			      (int)sizeof(h->prefix), h->prefix,
+			      (int)sizeof(h->name), h->name);
+	else
+		name = strndup(h->name, sizeof(h->name));
+
+	return name;
+}
+
+static void archive_add_member(struct archive *a, size_t *size, char *name,
+			       const char *data, size_t len)
+{
+	struct archive_member *m;
+	char *s = name;
+
+	while (strncmp(s, "./", 2) == 0)
+		s += 2;
+	if (s != name)
+		memmove(name, s, strlen(s) + 1);
+
+	if (a->count == *size) {
+		*size = *size ? *size * 2 : 1024;
+		a->members = safe_realloc(a->members,
+					  *size * sizeof(*a->members));
+	}
+	m = &a->members[a->count++];
+	m->name = name;
+	m->data = data;
+	m->size = len;
+}
+
+static int member_cmp(const void *m1, const void *m2)
+{
+	return archive_name_cmp(((struct archive_member *)m1)->name,
+				((struct archive_member *)m2)->name);
+}
+
+static void archive_index(struct archive *a)
+{
+	const char *p = a->raw.data;
+	const char *end = a->raw.data + a->raw.len;
+	char *long_name = NULL;
+	size_t size = 0, i;
+
+	while (p + TAR_BLOCK <= end) {
+		struct tar_header *h = (struct tar_header *)p;
+		const char *data = p + TAR_BLOCK;
+		size_t len;
+
+		if (h->name[0] == '\0')
+			break;
+
+		len = parse_octal(h->size, sizeof(h->size));
+		if (data + len > end)
+			fail("Truncated archive '%s'\n", a->path);
+
+		switch (h->typeflag) {
+		case 'x':
+			free(long_name);
+			long_name = pax_path(data, len);
+			break;
+		case 'L':
+			free(long_name);
+			long_name = strndup(data, len);
+			break;
+		case '0':
+		case '\0':
+			if (long_name == NULL)
+				long_name = header_name(h);
+			archive_add_member(a, &size, long_name, data, len);
+			long_name = NULL;
+			break;
+		default:
+			free(long_name);
+			long_name = NULL;
+			break;
+		}
+
+		p = data + (len + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+	}
+	free(long_name);
+
+	qsort(a->members, a->count, sizeof(*a->members), member_cmp);
+
+	a->names = hash_new(ARCHIVE_HASH_SIZE, NULL);
+	if (a->names == NULL)
+		fail("Cannot create the archive index\n");
+	for (i = 0; i < a->count; i++)
+		hash_add(a->names, a->members[i].name, &a->members[i]);
+}
+
+struct archive *archive_open(const char *path)
+{
+	struct archive *a = safe_zmalloc(sizeof(*a));
+
+	a->path = safe_strdup(path);
+	buffer_init(&a->raw);
+	archive_load(a);
+	archive_index(a);
+
+	return a;
+}
+
+void archive_close(struct archive *a)
+{
+	size_t i;
+
+	hash_free(a->names);
+	for (i = 0; i < a->count; i++)
+		free(a->members[i].name);
+	free(a->members);
+	buffer_free(&a->raw);
+	free(a->path);
+	free(a);
+}
+
+bool archive_contains(struct archive *a, const char *name)
+{
+	return hash_find(a->names, name) != NULL;
+}
+
+FILE *archive_fopen(struct archive *a, const char *name)
+{
+	struct archive_member *m = hash_find(a->names, name);
+	FILE *file;
+
+	if (m == NULL)
+		fail("No file '%s' in archive '%s'\n", name, a->path);
+
+	/* fmemopen() does not accept empty buffers */
+	if (m->size == 0)
+		file = fopen("/dev/null", "r");
+	else
+		file = fmemopen((void *)m->data, m->size, "r");
+	if (file == NULL)
+		fail("Cannot open '%s' in archive '%s': %s\n", name, a->path,
+		     strerror(errno));
+
+	return file;
+}
+
+/*
+ * Open filename in the kabi directory dir, or in the archive ar if it is
+ * not NULL. The path used in messages is returned in *path.
+ */
+FILE *kabi_fopen(char *dir, struct archive *ar, const char *filename,
+		 char **path)
+{
+	safe_asprintf(path, "%s/%s", dir, filename);
+
+	if (ar != NULL)
+		return archive_fopen(ar, filename);
+
+	return safe_fopen(*path);
+}
+
+/* Is there a filename in the kabi directory dir (or archive ar)? */
+bool kabi_exists(char *dir, struct archive *ar, const char *filename)
+{
+	char *path;
+	bool ret;
+
+	if (ar != NULL)
+		return archive_contains(ar, filename);
+
+	safe_asprintf(&path, "%s/%s", dir, filename);
+	ret = access(path, F_OK) == 0;
+	free(path);
+
+	return ret;
+}
+
+/* Read (or map) the whole file at path, false if it does not exist */
+static bool kabi_read(const char *path, struct kabi_data *d)
+{
+	struct stat st;
+	size_t len = 0;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		if (errno == ENOENT)
+			return false;
+		fail("Cannot open '%s': %s\n", path, strerror(errno));
+	}
+	if (fstat(fd, &st) < 0)
+		fail("Cannot stat '%s': %s\n", path, strerror(errno));
+
+	if (st.st_size >= KABI_MMAP_MIN) {
+		d->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (d->map == MAP_FAILED)
+			fail("Cannot map '%s': %s\n", path, strerror(errno));
+		d->data = d->map;
+		d->len = st.st_size;
+		close(fd);
+		return true;
+	}
+
+	/* a single read() for most files, the file may change meanwhile */
+	d->buf = safe_zmalloc(st.st_size + 1);
+	while (len < (size_t)st.st_size) {
+		ssize_t n = read(fd, d->buf + len, st.st_size - len);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			fail("Cannot read '%s': %s\n", path, strerror(errno));
+		}
+		if (n == 0)
+			break;
+		len += n;
+	}
+	d->data = d->buf;
+	d->len = len;
+	close(fd);
+
+	return true;
+}
+
+/*
+ * Get the content of filename in the kabi directory dir, or in the archive
+ * ar if it is not NULL, without copying the archive members. If dir is
+ * NULL, filename is the path of the file. The path used in messages is
+ * returned in *path, even if the file does not exist (the return value is
+ * then false). The content must be released by kabi_unload().
+ */
+bool kabi_load(char *dir, struct archive *ar, const char *filename,
+	       struct kabi_data *d, char **path)
+{
+	struct archive_member *m;
+
+	memset(d, 0, sizeof(*d));
+	if (dir != NULL)
+		safe_asprintf(path, "%s/%s", dir, filename);
+	else
+		*path = safe_strdup(filename);
+
+	if (ar == NULL)
+		return kabi_read(*path, d);
+
+	m = hash_find(ar->names, filename);
+	if (m == NULL)
+		return false;
+	d->data = m->data;
+	d->len = m->size;
+
+	return true;
+}
+
+void kabi_unload(struct kabi_data *d)
+{
+	if (d->map != NULL)
+		munmap(d->map, d->len);
+	free(d->buf);
+}
+
+/*
+ * Start reading filename in the kabi directory dir in the background, so
+ * that it is in the page cache by the time it is loaded.
+ */
+void kabi_prefetch(char *dir, const char *filename)
+{
+	char *path;
+	int fd;
+
+	safe_asprintf(&path, "%s/%s", dir, filename);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	free(path);
+
+	/* just a hint, kabi_load() reports the errors */
+	if (fd < 0)
+		return;
+	posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+	close(fd);
+}
+
+/*
+ * Call cb() on all the members of the archive, with the same semantic as
+ * walk_dir() for the files.
+ */
+void archive_walk(struct archive *a, walk_rv_t (*cb)(char *, void *),
+		  void *arg)
+{
+	size_t i = 0;
+
+	while (i < a->count) {
+		char *name = a->members[i++].name;
+		char *slash;
+		size_t dirlen;
+
+		switch (cb(name, arg)) {
+		case WALK_CONT:
+			break;
+		case WALK_STOP:
+			return;
+		case WALK_SKIP:
+			/* skip the rest of the directory */
+			slash = strrchr(name, '/');
+			dirlen = slash ? slash - name + 1 : 0;
+			while (i < a->count &&
+			       strncmp(a->members[i].name, name, dirlen) == 0)
+				i++;
+			break;
+		}
+	}
+}
@@ -0,0 +1,70 @@
+/*
+	Copyright(C) 2016, Red Hat, Inc., Stanislav Kozina
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Single file (tar) storage of the kABI records
+ *
+ * An archive is a tar file, compressed with zstd when its name ends with
+ * ".zst". The members are stored in the order walk_dir() would list the
+ * files of the corresponding directory, with no timestamp or ownership, so
+ * that the same records always give the same archive.
+ */
+
+#ifndef ARCHIVE_H_
+#define ARCHIVE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "utils.h"
+
+struct archive_writer;
+struct archive;
+
+/* Content of a kabi file, see kabi_load() */
+struct kabi_data {
+	const char *data;
+	size_t len;
+	void *map;	/* mapped file or NULL */
+	char *buf;	/* read file or NULL */
+};
+
+bool is_archive(const char *path);
+int archive_name_cmp(const char *name1, const char *name2);
+
+struct archive_writer *archive_writer_open(const char *path);
+void archive_writer_add(struct archive_writer *w, const char *name,
+			const char *data, size_t len);
+void archive_writer_close(struct archive_writer *w);
+
+struct archive *archive_open(const char *path);
+void archive_close(struct archive *a);
+bool archive_contains(struct archive *a, const char *name);
+FILE *archive_fopen(struct archive *a, const char *name);
+void archive_walk(struct archive *a, walk_rv_t (*cb)(char *, void *),
+		  void *arg);
+
+FILE *kabi_fopen(char *dir, struct archive *ar, const char *filename,
+		 char **path);
+bool kabi_exists(char *dir, struct archive *ar, const char *filename);
+bool kabi_load(char *dir, struct archive *ar, const char *filename,
+	       struct kabi_data *d, char **path);
+void kabi_unload(struct kabi_data *d);
+void kabi_prefetch(char *dir, const char *filename);
+
+#endif /* ARCHIVE_H_ */
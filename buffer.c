@@ -0,0 +1,132 @@
+/*
+	Copyright(C) 2016, Red Hat, Inc., Stanislav Kozina
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Growable output buffer
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "utils.h"
+
+#define BUFFER_INITIAL_SIZE (64 * 1024)
+
+void buffer_init(struct buffer *buf)
+{
+	buf->data = NULL;
+	buf->len = 0;
+	buf->size = 0;
+}
+
+void buffer_free(struct buffer *buf)
+{
+	free(buf->data);
+	buffer_init(buf);
+}
+
+/* Make room for at least len more bytes */
+void buffer_grow(struct buffer *buf, size_t len)
+{
+	size_t size = buf->size ? buf->size : BUFFER_INITIAL_SIZE;
+
+	if (buf->len + len <= buf->size)
+		return;
+
+	while (size < buf->len + len)
+		size *= 2;
+
+	buf->data = safe_realloc(buf->data, size);
+	buf->size = size;
+}
+
+void buffer_put(struct buffer *buf, const char *s, size_t len)
+{
+	buffer_grow(buf, len);
+	memcpy(buf->data + buf->len, s, len);
+	buf->len += len;
+}
+
+void buffer_puts(struct buffer *buf, const char *s)
+{
+	/* that's what glibc printf does */
+	if (s == NULL)
+		s = "(null)";
+
+	buffer_put(buf, s, strlen(s));
+}
+
+static void buffer_put_base(struct buffer *buf, unsigned long val,
+			    unsigned int base)
+{
+	static const char digits[] = "0123456789abcdef";
+	char tmp[sizeof(val) * 8];
+	char *p = tmp + sizeof(tmp);
+
+	do {
+		*--p = digits[val % base];
+		val /= base;
+	} while (val);
+
+	buffer_put(buf, p, tmp + sizeof(tmp) - p);
+}
+
+void buffer_put_uint(struct buffer *buf, unsigned long val)
+{
+	buffer_put_base(buf, val, 10);
+}
+
+void buffer_put_int(struct buffer *buf, long val)
+{
+	if (val < 0) {
+		buffer_putc(buf, '-');
+		buffer_put_base(buf, -(unsigned long)val, 10);
+	} else {
+		buffer_put_base(buf, val, 10);
+	}
+}
+
+void buffer_put_hex(struct buffer *buf, unsigned long val)
+{
+	buffer_put_base(buf, val, 16);
+}
+
+/*
+ * Write the whole buffer to fd
+ *
+ * Returns 0 on success, -1 with errno set otherwise.
+ */
+int buffer_write(struct buffer *buf, int fd)
+{
+	size_t done = 0;
+	ssize_t ret;
+
+	while (done < buf->len) {
+		ret = write(fd, buf->data + done, buf->len - done);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		done += ret;
+	}
+
+	return 0;
+}
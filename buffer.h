@@ -0,0 +1,61 @@
+/*
+	Copyright(C) 2016, Red Hat, Inc., Stanislav Kozina
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Growable output buffer
+ *
+ * Used to serialize a whole file in memory and write it at once. The
+ * formatting functions give the same output as the corresponding printf
+ * conversions.
+ */
+
+#ifndef BUFFER_H_
+#define BUFFER_H_
+
+#include <stddef.h>
+
+struct buffer {
+	char *data;
+	size_t len;
+	size_t size;
+};
+
+void buffer_init(struct buffer *buf);
+void buffer_free(struct buffer *buf);
+void buffer_grow(struct buffer *buf, size_t len);
+
+static inline void buffer_reset(struct buffer *buf)
+{
+	buf->len = 0;
+}
+
+static inline void buffer_putc(struct buffer *buf, char c)
+{
+	if (buf->len == buf->size)
+		buffer_grow(buf, 1);
+	buf->data[buf->len++] = c;
+}
+
+void buffer_put(struct buffer *buf, const char *s, size_t len);
+void buffer_puts(struct buffer *buf, const char *s); /* %s */
+void buffer_put_uint(struct buffer *buf, unsigned long val); /* %lu */
+void buffer_put_int(struct buffer *buf, long val); /* %li */
+void buffer_put_hex(struct buffer *buf, unsigned long val); /* %lx */
+
+int buffer_write(struct buffer *buf, int fd);
+
+#endif /* BUFFER_H_ */
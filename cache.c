@@ -0,0 +1,222 @@
+/*
+	Copyright(C) 2017, Red Hat, Inc.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Compare verdict cache, see cache.h
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "buffer.h"
+#include "hash.h"
+#include "utils.h"
+
+#define CACHE_HASH_SIZE 4096
+
+struct cache_entry {
+	struct cache_key key;
+	int ret;
+	char report[];
+};
+
+struct compare_cache {
+	int fd;		/* opened for appending */
+	struct hash *entries;
+	struct buffer buf;
+};
+
+static void cache_insert(struct compare_cache *cache,
+			 const struct cache_key *key, int ret,
+			 const char *report, size_t len)
+{
+	struct cache_entry *e = safe_zmalloc(sizeof(*e) + len + 1);
+
+	e->key = *key;
+	e->ret = ret;
+	if (len > 0)
+		memcpy(e->report, report, len);
+
+	if (hash_add_bin(cache->entries, (const char *)&e->key,
+			 sizeof(e->key), e) < 0)
+		fail("Cannot add to the compare cache\n");
+}
+
+/*
+ * Lock the whole cache file: shared to append, exclusive to read and
+ * repair it. These locks belong to the process, unlike flock(): the batch
+ * children inheriting the file descriptor don't share theirs.
+ */
+static int cache_lock(struct compare_cache *cache, short type)
+{
+	struct flock fl = { .l_type = type, .l_whence = SEEK_SET };
+	int ret;
+
+	do {
+		ret = fcntl(cache->fd, F_SETLKW, &fl);
+	} while (ret < 0 && errno == EINTR);
+
+	return ret;
+}
+
+/*
+ * Read the entries of the cache file. The file is truncated at the first
+ * malformed one, such as an entry cut by a crash, so that the entries
+ * appended later can be read.
+ */
+static void cache_read(struct compare_cache *cache, const char *path)
+{
+	struct stat sb;
+	char *data, *p, *end;
+	ssize_t n;
+	size_t done = 0;
+
+	if (fstat(cache->fd, &sb) < 0)
+		fail("Cannot stat '%s': %s\n", path, strerror(errno));
+
+	data = safe_zmalloc(sb.st_size + 1);
+	while (done < (size_t)sb.st_size) {
+		n = pread(cache->fd, data + done, sb.st_size - done, done);
+		if (n < 0)
+			fail("Cannot read '%s': %s\n", path, strerror(errno));
+		if (n == 0)
+			break;
+		done += n;
+	}
+
+	p = data;
+	end = data + done;
+	while (p < end) {
+		struct cache_key key;
+		char *nl = memchr(p, '\n', end - p);
+		size_t len;
+		int ret;
+
+		if (nl == NULL)
+			break;
+		*nl = '\0';
+		if (sscanf(p, "%" SCNx64 " %" SCNx64 " %" SCNx64 " %d %zu",
+			   &key.old_hash, &key.new_hash, &key.options,
+			   &ret, &len) != 5)
+			break;
+		p = nl + 1;
+		if (len > (size_t)(end - p))
+			break;
+
+		cache_insert(cache, &key, ret, p, len);
+		p += len;
+	}
+
+	if (p < end && ftruncate(cache->fd, p - data) < 0)
+		fail("Cannot truncate '%s': %s\n", path, strerror(errno));
+
+	free(data);
+}
+
+/* Open the cache at path, which is created if it does not exist */
+struct compare_cache *cache_open(const char *path)
+{
+	struct compare_cache *cache = safe_zmalloc(sizeof(*cache));
+
+	cache->fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+	if (cache->fd < 0)
+		fail("Cannot open the compare cache '%s': %s\n", path,
+		     strerror(errno));
+
+	cache->entries = hash_new(CACHE_HASH_SIZE, free);
+	if (cache->entries == NULL)
+		fail("Cannot create the compare cache hash\n");
+	buffer_init(&cache->buf);
+
+	if (cache_lock(cache, F_WRLCK) < 0)
+		fail("Cannot lock '%s': %s\n", path, strerror(errno));
+	cache_read(cache, path);
+	cache_lock(cache, F_UNLCK);
+
+	return cache;
+}
+
+void cache_close(struct compare_cache *cache)
+{
+	if (cache == NULL)
+		return;
+
+	close(cache->fd);
+	hash_free(cache->entries);
+	buffer_free(&cache->buf);
+	free(cache);
+}
+
+/* Find the verdict of a comparison, *report is NULL if there is none */
+bool cache_find(struct compare_cache *cache, const struct cache_key *key,
+		int *ret, const char **report)
+{
+	struct cache_entry *e;
+
+	e = hash_find_bin(cache->entries, (const char *)key, sizeof(*key));
+	if (e == NULL)
+		return false;
+
+	*ret = e->ret;
+	*report = e->ret != 0 ? e->report : NULL;
+
+	return true;
+}
+
+/* Add a verdict, with its report if it is not NULL */
+void cache_add(struct compare_cache *cache, const struct cache_key *key,
+	       int ret, const char *report)
+{
+	struct buffer *b = &cache->buf;
+	size_t len = report != NULL ? strlen(report) : 0;
+	char hex[17];
+
+	cache_insert(cache, key, ret, report, len);
+
+	buffer_reset(b);
+	snprintf(hex, sizeof(hex), "%016" PRIx64, key->old_hash);
+	buffer_put(b, hex, 16);
+	buffer_putc(b, ' ');
+	snprintf(hex, sizeof(hex), "%016" PRIx64, key->new_hash);
+	buffer_put(b, hex, 16);
+	buffer_putc(b, ' ');
+	snprintf(hex, sizeof(hex), "%016" PRIx64, key->options);
+	buffer_put(b, hex, 16);
+	buffer_putc(b, ' ');
+	buffer_put_int(b, ret);
+	buffer_putc(b, ' ');
+	buffer_put_uint(b, len);
+	buffer_putc(b, '\n');
+	if (len > 0)
+		buffer_put(b, report, len);
+
+	/*
+	 * A failure only costs verdicts computed again: the next cache_open()
+	 * drops a partial entry, and the entries written after it.
+	 */
+	if (cache_lock(cache, F_RDLCK) < 0 || buffer_write(b, cache->fd) < 0)
+		fprintf(stderr, "Cannot write to the compare cache: %s\n",
+			strerror(errno));
+	cache_lock(cache, F_UNLCK);
+}
@@ -0,0 +1,58 @@
+/*
+	Copyright(C) 2017, Red Hat, Inc.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Compare verdict cache
+ *
+ * compare --cache keeps the outcome of the comparison of each pair of
+ * files, keyed by the hashes of their contents and the hash of the
+ * options. The file has an entry per comparison, with the exit status and
+ * the length of the report, followed by the report itself:
+ *
+ * 0123456789abcdef fedcba9876543210 0011223344556677 2 35
+ * Replaced:
+ * -0x4 int y;
+ * +0x4 long y;
+ *
+ * The entries are appended with a single write, so that several compare
+ * processes can share the file. Opening the cache truncates it at the
+ * first malformed entry: the entries appended after it would be lost.
+ */
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct compare_cache;
+
+struct cache_key {
+	uint64_t old_hash;
+	uint64_t new_hash;
+	uint64_t options;
+};
+
+struct compare_cache *cache_open(const char *path);
+void cache_close(struct compare_cache *cache);
+bool cache_find(struct compare_cache *cache, const struct cache_key *key,
+		int *ret, const char **report);
+void cache_add(struct compare_cache *cache, const struct cache_key *key,
+	       int ret, const char *report);
+
+#endif /* CACHE_H_ */
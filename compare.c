@@ -25,13 +25,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <libgen.h>
 
 #include "main.h"
 #include "objects.h"
 #include "utils.h"
 #include "compare.h"
+#include "archive.h"
+#include "manifest.h"
+#include "hash.h"
+#include "kabi-dw.h"
+#include "cache.h"
+#include "buffer.h"
+
+/* Size of the hash of the parsed files of the old dump */
+#define COMPARE_OBJS_SIZE 4096
 
 /* diff -u style prefix for tree comparison */
 #define ADD_PREFIX "+"
@@ -75,19 +86,19 @@ static bool is_duplicate(char *filename)
 }
 
 static void _print_node_list(const char *s, const char *prefix,
-			     obj_list_t *list, obj_list_t *last, FILE *stream) {
-	obj_list_t *l = list;
+			     obj_list_head_t *list, unsigned int first,
+			     unsigned int last, FILE *stream) {
+	unsigned int i;
 
 	fprintf(stream, "%s:\n", s);
-	while (l && l != last) {
-		obj_print_tree__prefix(l->member, prefix, stream);
-		l = l->next;
-	}
+	for (i = first; i < last; i++)
+		obj_print_tree__prefix(list->member[i], prefix, stream);
 }
 
 static void print_node_list(const char *s, const char *prefix,
-			    obj_list_t *list, FILE *stream) {
-	_print_node_list(s, prefix, list, NULL, stream);
+			    obj_list_head_t *list, unsigned int first,
+			    FILE *stream) {
+	_print_node_list(s, prefix, list, first, list->len, stream);
 }
 
 
@@ -120,16 +131,10 @@ static int compare_two_files(const char *filename, const char *newfile,
 
 static int cmp_node_reffile(obj_t *o1, obj_t *o2)
 {
-	char *s1 = filenametotype(o1->base_type);
-	char *s2 = filenametotype(o2->base_type);
 	int len;
-	bool ret;
-
-	ret = safe_streq(s1, s2);
-	free(s1);
-	free(s2);
 
-	if (!ret)
+	/* the types are interned */
+	if (global_type_get(o1->base_type) != global_type_get(o2->base_type))
 		return CMP_DIFF;
 
 	/*
@@ -198,12 +203,59 @@ static int cmp_nodes(obj_t *o1, obj_t *o2)
 	return _cmp_nodes(o1, o2, false);
 }
 
-typedef enum {
-	DIFF_INSERT,
-	DIFF_DELETE,
-	DIFF_REPLACE,
-	DIFF_CONT,
-} diff_ret_t;
+/*
+ * Key of a list member: two members can only match when their keys are
+ * equal. It covers everything _cmp_nodes() requires to be equal, but not
+ * the offset, alignment, byte size or the content of the referenced files.
+ */
+static uint64_t member_key(obj_t *o)
+{
+	unsigned long v[] = {
+		o->type,
+		o->name != NULL,
+		o->base_type != NULL,
+		o->ptr != NULL,
+		is_weak(o),
+		has_constant(o) ? o->constant : 0,
+		has_index(o) ? o->index : 0,
+		is_bitfield(o),
+		is_bitfield(o) ? o->last_bit - o->first_bit : 0,
+	};
+	uint64_t h = manifest_hash((const char *)v, sizeof(v));
+
+	if (o->name != NULL)
+		h = manifest_hash_update(h, o->name, strlen(o->name) + 1);
+	if (is_weak(o) && o->link != NULL)
+		h = manifest_hash_update(h, o->link, strlen(o->link) + 1);
+
+	if (o->type == __type_reffile) {
+		const char *type = global_type_get(o->base_type);
+
+		h = manifest_hash_update(h, type, strlen(type) + 1);
+	} else if (o->base_type != NULL) {
+		h = manifest_hash_update(h, o->base_type,
+					 strlen(o->base_type) + 1);
+	}
+
+	return h;
+}
+
+/*
+ * Are o1 and o2 the same member, possibly changed? The keys rule out most
+ * of the pairs, _cmp_nodes() confirms the others.
+ */
+static bool list_match(obj_t *o1, uint64_t key1, obj_t *o2, uint64_t key2)
+{
+	return key1 == key2 && _cmp_nodes(o1, o2, true) != CMP_DIFF;
+}
+
+/* Maximum number of inserted and deleted members list_diff() looks for */
+#define LIST_DIFF_MAX 2048
+
+struct diff_pair {
+	unsigned int i1;
+	unsigned int i2;
+};
 
 /*
  * When field are changed or moved around, there can be several diff
@@ -212,64 +264,127 @@ typedef enum {
  * of kABI (mainly shifted fields, which most likely indicate that
  * some change to the ABI have been overlooked).
  *
- * This function compare two lists whose first member diverge. We're
- * looking at four different scenarios:
- * - N fields appears only in list2, then the lists rejoined (insertion)
- * - P fields appears only in list1, then the lists rejoined (deletion)
- * - Q fields diverges, then the lists rejoined (replacement)
- * - the lists never rejoined
+ * The members of list1 and list2 from the indexes start1 and start2 are
+ * aligned with Myers' algorithm, which finds the longest sequence of
+ * matching members in O((N+M)D) for D inserted or deleted members. The
+ * matching pairs are returned in *pairs, followed by the pair of the list
+ * lengths, and their count (without the last one).
  *
- * Since for the same change, several of the scenarios above might
- * represent the change, we choose the one that minimize the diff
- * (min(N,P,Q)). So we're looking for the first element of list1 in
- * list2, the first element of list2 in list1 or the first line where
- * list1 and list2 do not differ, whichever comes first.
+ * The members in between two pairs have been replaced, inserted or
+ * deleted. Past LIST_DIFF_MAX changes, no pair is returned and the lists
+ * are compared in order.
  */
-static diff_ret_t list_diff(obj_list_t *list1, obj_list_t **next1,
-			    obj_list_t *list2, obj_list_t **next2)
-{
-	obj_t *o1 = list2->member, *o2 = list1->member, *o = o1;
-	int d1 = 0, d2 = 0, ret;
-	obj_list_t *next;
-
-	next = *next1 = list1;
-	*next2 = list2;
-
-	while (next) {
-		ret = _cmp_nodes(o, next->member, true);
-		if (ret == CMP_SAME || ret == CMP_OFFSET
-		    || ret == CMP_ALIGNMENT) {
-			if (o == o1)
-				/* We find the first element of list2
-				   on list1, that is d1 elements have
-				   been removed from list1 */
-				return DIFF_DELETE;
+static unsigned int list_diff(obj_list_head_t *list1, unsigned int start1,
+			      obj_list_head_t *list2, unsigned int start2,
+			      struct diff_pair **pairs)
+{
+	int n = list1->len - start1, m = list2->len - start2;
+	int max = n + m, d, k, x, y;
+	obj_t **m1 = list1->member + start1, **m2 = list2->member + start2;
+	uint64_t *keys1, *keys2;
+	int *vbuf, *v, *trace = NULL, *prev;
+	unsigned int count = 0, tsize = 0;
+	struct diff_pair *p;
+
+	keys1 = safe_zmalloc((n + 1) * sizeof(*keys1));
+	keys2 = safe_zmalloc((m + 1) * sizeof(*keys2));
+	for (x = 0; x < n; x++)
+		keys1[x] = member_key(m1[x]);
+	for (y = 0; y < m; y++)
+		keys2[y] = member_key(m2[y]);
+
+	/*
+	 * v[k] is the furthest x reached on the diagonal k = x - y. It is
+	 * saved after each step d in trace, at the offset d * d, to walk
+	 * back the path.
+	 */
+	vbuf = safe_zmalloc((2 * max + 3) * sizeof(*vbuf));
+	v = vbuf + max + 1;
+	for (d = 0; d <= max; d++) {
+		bool done = false;
+
+		for (k = -d; k <= d; k += 2) {
+			if (k == -d || (k != d && v[k - 1] < v[k + 1]))
+				x = v[k + 1];
 			else
-				return DIFF_INSERT;
-		}
+				x = v[k - 1] + 1;
+			y = x - k;
 
-		if (d1 == d2)  {
-			ret = _cmp_nodes((*next1)->member, (*next2)->member,
-					 true);
-			if (ret == CMP_SAME || ret == CMP_OFFSET
-			    || ret == CMP_ALIGNMENT) {
-				/* d1 fields have been replaced */
-				return DIFF_REPLACE;
+			while (x < n && y < m &&
+			       list_match(m1[x], keys1[x], m2[y], keys2[y])) {
+				x++;
+				y++;
+			}
+			v[k] = x;
+
+			if (x >= n && y >= m) {
+				done = true;
+				break;
 			}
+		}
+
+		if ((d + 1) * (d + 1) > tsize) {
+			tsize = 2 * (d + 1) * (d + 1);
+			trace = safe_realloc(trace, tsize * sizeof(*trace));
+		}
+		memcpy(trace + d * d, v - d, (2 * d + 1) * sizeof(*trace));
+		if (done)
+			break;
+
+		/* too many changes, give up and compare them in order */
+		if (d == LIST_DIFF_MAX) {
+			d = -1;
+			break;
+		}
+	}
 
+	/* the pairs are found backwards, the lengths go first */
+	p = safe_zmalloc(((n < m ? n : m) + 1) * sizeof(*p));
+	p[count++] = (struct diff_pair){ list1->len, list2->len };
+	x = n;
+	y = m;
+	for (; d >= 0; d--) {
+		int px = 0, py = 0, snake = 0;
+
+		if (d > 0) {
+			prev = trace + (d - 1) * (d - 1) + d - 1;
+			k = x - y;
+			if (k == -d || (k != d && prev[k - 1] < prev[k + 1])) {
+				px = prev[k + 1];
+				py = px - k - 1;
+				snake = px;
+			} else {
+				px = prev[k - 1];
+				py = px - k + 1;
+				snake = px + 1;
+			}
 		}
 
-		if (!(*next1) || !((*next1)->next) || (d2  < d1)) {
-			next = *next2 = (*next2)->next;
-			o = o2;
-			d2++;
-		} else {
-			next = *next1 = (*next1)->next;
-			o = o1;
-			d1++;
+		while (x > snake) {
+			x--;
+			y--;
+			p[count++] = (struct diff_pair){ start1 + x,
+							 start2 + y };
 		}
+		x = px;
+		y = py;
+	}
+
+	free(trace);
+	free(vbuf);
+	free(keys2);
+	free(keys1);
+
+	/* reverse */
+	for (k = 0; k < (int)count / 2; k++) {
+		struct diff_pair tmp = p[k];
+
+		p[k] = p[count - k - 1];
+		p[count - k - 1] = tmp;
 	}
-	return DIFF_CONT;
+	*pairs = p;
+
+	return count - 1;
 }
 
 /*
@@ -290,14 +405,25 @@ static bool worthy_of_print(obj_t *o)
 		(o->type == __type_var);
 }
 
-static void print_two_nodes(const char *s, obj_t *o1, obj_t *o2, FILE *stream)
-{
+/*
+ * The nodes compared by the callers of _compare_tree(). The parent fields
+ * can't be used: the trees kept in memory by generate share subtrees.
+ */
+struct compare_ancestors {
+	obj_t *o1;
+	obj_t *o2;
+	const struct compare_ancestors *up;
+};
 
+static void print_two_nodes(const char *s, obj_t *o1, obj_t *o2,
+			    const struct compare_ancestors *up, FILE *stream)
+{
 	while (!worthy_of_print(o1)) {
-		o1 = o1->parent;
-		o2 = o2->parent;
-		if ((o1 == NULL) || (o2 == NULL))
+		if (up == NULL)
 			fail("No ancestor worthy of print\n");
+		o1 = up->o1;
+		o2 = up->o2;
+		up = up->up;
 	}
 	fprintf(stream, "%s:\n", s);
 	obj_print_tree__prefix(o1, DEL_PREFIX, stream);
@@ -312,10 +438,13 @@ typedef struct compare_config_s {
 	int follow;
 	char *old_dir;
 	char *new_dir;
+	struct archive *old_ar; /* old_dir is an archive */
+	struct archive *new_ar; /* new_dir is an archive */
+	struct manifest *old_manifest;
+	struct manifest *new_manifest;
 	char *filename;
-	char **flist;
-	int flistsz;
-	int flistcnt;
+	struct hash *followed; /* files compared for the current one */
+	unsigned long generation; /* of the current file in followed */
 	int ret;
 	/*
 	 * The following options allow to hide some symbol changes in
@@ -328,11 +457,18 @@ typedef struct compare_config_s {
 	int no_added;    /* symbols added at the end of a struct/union... */
 	int no_removed;  /* symbols removed at the end of a struct/union... */
 	int no_moved_files; /* file that has been moved (or removed) */
+	int impact; /* report the changed files with the impacted symbols */
+	int batch; /* compare old_dir to several dumps */
+	unsigned int jobs; /* dumps compared in parallel in batch mode */
+	struct hash *old_objs; /* parsed files of old_dir, kept in batch mode */
+	struct compare_baseline *baseline; /* old_dir is kept by serve */
+	struct kabi_dw_diff *result; /* changes collected for the library */
+	struct hash *new_objs; /* trees of new_dir, in memory in generate */
+	char *cache_path;
+	struct compare_cache *cache; /* verdicts of earlier runs */
 } compare_config_t;
 
-compare_config_t compare_config = {false, false, false, false, 0,
-				   NULL, NULL, NULL, NULL,
-				   0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+compare_config_t compare_config;
 
 static void message_alignment_value(unsigned v, FILE *stream)
 {
@@ -380,10 +516,17 @@ static void message_byte_size(obj_t *o1, obj_t *o2, FILE *stream)
 	fprintf(stream, "\n");
 }
 
-static int _compare_tree(obj_t *o1, obj_t *o2, FILE *stream)
+static int _compare_tree(obj_t *o1, obj_t *o2,
+			 const struct compare_ancestors *up, FILE *stream)
 {
-	obj_list_t *list1 = NULL, *list2 = NULL;
+	struct compare_ancestors here = { o1, o2, up };
+	obj_list_head_t *list1 = o1->member_list, *list2 = o2->member_list;
+	unsigned int i1 = 0, len1 = obj_list_len(list1);
+	unsigned int i2 = 0, len2 = obj_list_len(list2);
+	struct diff_pair end = { len1, len2 }, *pairs;
+	unsigned int p, npairs = 0;
 	int ret = COMP_SAME, tmp;
+	bool tail = false;
 
 	tmp = cmp_nodes(o1, o2);
 	if (tmp) {
@@ -395,7 +538,7 @@ static int _compare_tree(obj_t *o1, obj_t *o2, FILE *stream)
 			   (tmp == CMP_DIFF && !compare_config.no_replaced)) {
 			const char *s =	(tmp == CMP_OFFSET) ?
 				"Shifted" : "Replaced";
-			print_two_nodes(s, o1, o2, stream);
+			print_two_nodes(s, o1, o2, up, stream);
 			ret = COMP_CONT;
 		} else if (tmp == CMP_ALIGNMENT) {
 			message_alignment(o1, o2, stream);
@@ -409,74 +552,79 @@ static int _compare_tree(obj_t *o1, obj_t *o2, FILE *stream)
 			return ret;
 	}
 
-	if (o1->member_list)
-		list1 = o1->member_list->first;
-	if (o2->member_list)
-		list2 = o2->member_list->first;
-
-	while (list1 && list2) {
-		if (cmp_nodes(list1->member, list2->member) == CMP_DIFF) {
-			int index;
-			obj_list_t *next1, *next2;
+	if (len1 == 0 || len2 == 0)
+		goto ptr;
 
-			index = list_diff(list1, &next1, list2, &next2);
+	/* the common case: the members don't move */
+	while (i1 < len1 && i2 < len2 &&
+	       cmp_nodes(list1->member[i1], list2->member[i2]) != CMP_DIFF) {
+		tmp = _compare_tree(list1->member[i1], list2->member[i2],
+				    &here, stream);
+		ret = comp_return_value(ret, tmp);
+		i1++;
+		i2++;
+	}
 
-			switch (index) {
-			case DIFF_INSERT:
-				/* Insertion */
-				if (!compare_config.no_inserted) {
-					_print_node_list("Inserted", ADD_PREFIX,
-							 list2, next2, stream);
-					ret = COMP_DIFF;
-				}
-				list2 = next2;
-				break;
-			case DIFF_DELETE:
-				/* Removal */
-				if (!compare_config.no_deleted) {
-					_print_node_list("Deleted", DEL_PREFIX,
-							 list1, next1, stream);
-					ret = COMP_DIFF;
-				}
-				list1 = next1;
-				break;
-			case DIFF_REPLACE:
-				/*
-				 * We could print the diff here, but relying on
-				 * the next calls to _compare_tree() to display
-				 * the replaced fields individually works too.
-				 */
-			case DIFF_CONT:
-				/* Nothing to do */
-				;
-			}
+	if (i1 < len1 && i2 < len2)
+		npairs = list_diff(list1, i1, list2, i2, &pairs);
+	else
+		pairs = &end;
+
+	for (p = 0; p <= npairs; p++) {
+		unsigned int next1 = pairs[p].i1, next2 = pairs[p].i2;
+
+		/* the members in between have been replaced */
+		while (i1 < next1 && i2 < next2) {
+			tmp = _compare_tree(list1->member[i1],
+					    list2->member[i2], &here, stream);
+			ret = comp_return_value(ret, tmp);
+			i1++;
+			i2++;
 		}
 
-		tmp =_compare_tree(list1->member, list2->member, stream);
-		ret = comp_return_value(ret, tmp);
-
-		list1 = list1->next;
-		list2 = list2->next;
-		if (!list1 && list2) {
-			if (!compare_config.no_added) {
+		if (p == npairs) {
+			tail = i1 < len1 || i2 < len2;
+			if (i2 < len2 && !compare_config.no_added) {
 				print_node_list("Added", ADD_PREFIX,
-						list2, stream);
+						list2, i2, stream);
 				ret = COMP_DIFF;
 			}
-			return ret;
-		}
-		if (list1 && !list2) {
-			if (!compare_config.no_removed) {
+			if (i1 < len1 && !compare_config.no_removed) {
 				print_node_list("Removed", DEL_PREFIX,
-						list1, stream);
+						list1, i1, stream);
 				ret = COMP_DIFF;
 			}
-			return ret;
+			break;
+		}
+
+		if (i2 < next2 && !compare_config.no_inserted) {
+			_print_node_list("Inserted", ADD_PREFIX,
+					 list2, i2, next2, stream);
+			ret = COMP_DIFF;
+		}
+		if (i1 < next1 && !compare_config.no_deleted) {
+			_print_node_list("Deleted", DEL_PREFIX,
+					 list1, i1, next1, stream);
+			ret = COMP_DIFF;
 		}
+
+		tmp = _compare_tree(list1->member[next1], list2->member[next2],
+				    &here, stream);
+		ret = comp_return_value(ret, tmp);
+		i1 = next1 + 1;
+		i2 = next2 + 1;
 	}
 
+	if (pairs != &end)
+		free(pairs);
+
+	/* the pointer is not compared past added or removed members */
+	if (tail)
+		return ret;
+
+ptr:
 	if (o1->ptr && o2->ptr) {
-		tmp = _compare_tree(o1->ptr, o2->ptr, stream);
+		tmp = _compare_tree(o1->ptr, o2->ptr, &here, stream);
 		ret = comp_return_value(ret, tmp);
 	}
 
@@ -488,45 +636,43 @@ static int _compare_tree(obj_t *o1, obj_t *o2, FILE *stream)
  */
 static int compare_tree(obj_t *o1, obj_t *o2, FILE *stream)
 {
-	return _compare_tree(o1, o2, stream);
+	return _compare_tree(o1, o2, NULL, stream);
 }
 
+/*
+ * Record that filename is compared for the current file, false if it
+ * already was. The files are kept with the generation of the file they
+ * were compared for: starting the next file is only a new generation.
+ */
 static bool push_file(const char *filename)
 {
-	int i, sz = compare_config.flistsz;
-	int cnt = compare_config.flistcnt;
-	char **flist = compare_config.flist;
-
-	for (i = 0; i < cnt; i++)
-		if (!strcmp(flist[i], filename))
-			return false;
-
-	if (!sz) {
-		compare_config.flistsz = sz = 16;
-		compare_config.flist = flist =
-			safe_zmalloc(16 * sizeof(char *));
-	}
-	if (cnt >= sz) {
-		sz *= 2;
-		compare_config.flistsz = sz;
-		compare_config.flist = flist =
-			safe_realloc(flist, sz * sizeof(char *));
+	compare_config_t *conf = &compare_config;
+	const void *gen;
+
+	if (conf->followed == NULL) {
+		conf->followed = hash_new(COMPARE_OBJS_SIZE, NULL);
+		if (conf->followed == NULL)
+			fail("Cannot create the followed files hash\n");
+		conf->generation = 1;
 	}
 
-	flist[cnt] = strdup(filename);
-	compare_config.flistcnt++;
+	/* hash_add() replaces the key of an existing entry too */
+	filename = global_string_get_copy(filename);
+	gen = hash_find(conf->followed, filename);
+	if (gen == (const void *)conf->generation)
+		return false;
+
+	if (hash_add(conf->followed, filename,
+		     (const void *)conf->generation) < 0)
+		fail("Cannot add '%s' to the followed files\n", filename);
 
 	return true;
 }
 
-static void free_files()
+/* Forget the files compared for the previous file */
+static void clear_files(void)
 {
-	int i;
-
-	for (i = 0; i < compare_config.flistcnt; i++)
-		free(compare_config.flist[i]);
-	free(compare_config.flist);
-	compare_config.flistcnt = compare_config.flistsz = 0;
+	compare_config.generation++;
 }
 
 static void compare_usage()
@@ -534,6 +680,8 @@ static void compare_usage()
 	printf("Usage:\n"
 	       "\tcompare [options] kabi_dir kabi_dir [kabi_file...]\n"
 	       "\tcompare [options] kabi_file kabi_file\n"
+	       "\tcompare [options] --batch kabi_dir kabi_dir...\n"
+	       "\nA kabi_dir can also be an archive written by generate.\n"
 	       "\nOptions:\n"
 	       "    -h, --help:\t\tshow this message\n"
 	       "    -k, --hide-kabi:\thide changes made by RH_KABI_REPLACE()\n"
@@ -557,12 +705,367 @@ static void compare_usage()
 	       "    --no-moved-files:\thide changes caused by symbols "
 	       "definition moving to another file\n\t\t\t"
 	       "Warning: it also hides symbols that are removed entirely\n"
+	       "    --impact:\t\treport each changed file once, with the "
+	       "exported symbols\n\t\t\tit impacts (needs dumps written "
+	       "by generate)\n"
 	       "    -s, --skip-duplicate:\tshow only the first version of a "
-	       "symbol when several exist\n");
+	       "symbol when several exist\n"
+	       "    --batch:\t\tcompare the first kabi_dir to each of the "
+	       "others,\n\t\t\tparsing it only once\n"
+	       "    -j, --jobs N:\tcompare to N dumps at a time in batch mode"
+	       "\n\t\t\t(default: the number of CPUs)\n"
+	       "    --cache file:\tkeep the verdicts in file, to skip the "
+	       "pairs of files\n\t\t\tcompared by earlier runs\n");
 
 	exit(1);
 }
 
+/*
+ * Files with the same content can't differ, unless we follow a referenced
+ * file that does: then the checksums, covering the referenced files, must
+ * match.
+ */
+static bool compare_unchanged(const char *filename, const char *filename2)
+{
+	return !compare_config.debug &&
+		manifest_same(compare_config.old_manifest, filename,
+			      compare_config.new_manifest, filename2,
+			      compare_config.follow);
+}
+
+/* A file read to hash its content, kept for its parsing */
+struct compare_read {
+	struct kabi_data data;
+	char *path;	/* NULL if not read */
+};
+
+static void compare_read_free(struct compare_read *r)
+{
+	if (r->path == NULL)
+		return;
+	kabi_unload(&r->data);
+	free(r->path);
+	r->path = NULL;
+}
+
+/* Load filename, unless r holds it already: then r is handed over */
+static bool compare_read_load(char *dir, struct archive *ar,
+			      const char *filename, struct compare_read *r,
+			      struct kabi_data *data, char **path)
+{
+	if (r == NULL || r->path == NULL)
+		return kabi_load(dir, ar, filename, data, path);
+
+	*data = r->data;
+	*path = r->path;
+	r->path = NULL;
+
+	return true;
+}
+
+/*
+ * Parse filename in old_dir, or its content read in r if not NULL. In
+ * batch mode, the trees are kept for the comparisons with all the dumps
+ * and must not be freed.
+ */
+static obj_t *compare_load_old(const char *filename, struct compare_read *r)
+{
+	struct kabi_data data;
+	obj_t *root;
+	char *path;
+
+	if (compare_config.old_objs != NULL) {
+		root = hash_find(compare_config.old_objs, filename);
+		if (root != NULL)
+			return root;
+	}
+
+	if (!compare_read_load(compare_config.old_dir, compare_config.old_ar,
+			       filename, r, &data, &path))
+		fail("Failed to open kABI file: %s\n", path);
+	root = obj_parse(data.data, data.len, path);
+	kabi_unload(&data);
+	free(path);
+
+	if (compare_config.hide_kabi)
+		obj_hide_kabi(root, compare_config.hide_kabi_new);
+
+	if (compare_config.old_objs != NULL &&
+	    hash_add(compare_config.old_objs,
+		     global_string_get_copy(filename), root) < 0)
+		fail("Cannot add '%s' to the parsed files\n", filename);
+
+	return root;
+}
+
+/* A dump kept in memory by serve, see compare_load_baseline() */
+struct compare_baseline {
+	char *path;	/* real path of the dump */
+	struct archive *ar;
+	struct manifest *manifest;
+	struct hash *objs;
+	bool hide_kabi;
+	bool hide_kabi_new;
+};
+
+static struct compare_baseline *baselines;
+static unsigned int nbaselines;
+
+static struct compare_baseline *compare_find_baseline(const char *dir)
+{
+	struct compare_baseline *b = NULL;
+	char *path;
+	unsigned int i;
+
+	if (nbaselines == 0)
+		return NULL;
+
+	path = realpath(dir, NULL);
+	if (path == NULL)
+		return NULL;
+	for (i = 0; i < nbaselines; i++) {
+		if (strcmp(baselines[i].path, path) == 0)
+			b = &baselines[i];
+	}
+	free(path);
+
+	return b;
+}
+
+static void compare_print_change(enum kabi_dw_change_type type,
+				 const char *filename, const char *report)
+{
+	switch (type) {
+	case KABI_DW_REMOVED:
+		printf("Symbol removed or moved: %s\n", filename);
+		break;
+	case KABI_DW_ADDED:
+		printf("Symbol added: %s\n", filename);
+		break;
+	default:
+		printf("Changes detected in: %s\n%s\n", filename, report);
+	}
+}
+
+/* Print the changes collected in diff, as compare does */
+void compare_print_diff(struct kabi_dw_diff *diff)
+{
+	unsigned int i;
+
+	for (i = 0; i < diff->count; i++)
+		compare_print_change(diff->changes[i].type,
+				     diff->changes[i].file,
+				     diff->changes[i].report);
+}
+
+/* Print a change of filename, or add it to the result of the library */
+static void compare_report(enum kabi_dw_change_type type,
+			   const char *filename, const char *report)
+{
+	struct kabi_dw_diff *diff = compare_config.result;
+	struct kabi_dw_change *change;
+
+	if (diff == NULL) {
+		compare_print_change(type, filename, report);
+		return;
+	}
+
+	/* the array doubles when count reaches a power of two */
+	if ((diff->count & (diff->count - 1)) == 0)
+		diff->changes = safe_realloc(diff->changes,
+			(diff->count ? 2 * diff->count : 1) *
+			sizeof(*diff->changes));
+	change = &diff->changes[diff->count++];
+	change->type = type;
+	change->file = safe_strdup(filename);
+	change->report = safe_strdup_or_null(report);
+}
+
+/*
+ * Parse filename in new_dir, or its content read in r if not NULL, or find
+ * its tree in memory. Returns NULL if the file does not exist.
+ */
+static obj_t *compare_load_new(const char *filename, struct compare_read *r)
+{
+	struct kabi_data data;
+	obj_t *root;
+	char *path;
+
+	if (compare_config.new_objs != NULL)
+		return hash_find(compare_config.new_objs, filename);
+
+	if (!compare_read_load(compare_config.new_dir, compare_config.new_ar,
+			       filename, r, &data, &path)) {
+		free(path);
+		return NULL;
+	}
+	root = obj_parse(data.data, data.len, path);
+	kabi_unload(&data);
+	free(path);
+
+	if (compare_config.hide_kabi)
+		obj_hide_kabi(root, compare_config.hide_kabi_new);
+
+	return root;
+}
+
+/* Hash of the options changing the verdicts and the reports */
+static uint64_t compare_options_hash(void)
+{
+	unsigned long v[] = {
+		FILEFMT_VERSION_MAJOR,
+		FILEFMT_VERSION_MINOR,
+		compare_config.hide_kabi,
+		compare_config.hide_kabi_new,
+		compare_config.follow,
+		compare_config.no_replaced,
+		compare_config.no_shifted,
+		compare_config.no_inserted,
+		compare_config.no_deleted,
+		compare_config.no_added,
+		compare_config.no_removed,
+		compare_config.no_moved_files,
+		display_options.no_offset,
+	};
+
+	return manifest_hash((const char *)v, sizeof(v));
+}
+
+/*
+ * Hash of the content of filename, from the manifest or the file. The file
+ * read is kept in r for its parsing.
+ */
+static bool compare_file_hash(char *dir, struct archive *ar,
+			      struct manifest *m, const char *filename,
+			      uint64_t *hash, struct compare_read *r)
+{
+	if (manifest_lookup(m, filename, false, hash))
+		return true;
+
+	if (!kabi_load(dir, ar, filename, &r->data, &r->path)) {
+		free(r->path);
+		r->path = NULL;
+		return false;
+	}
+	*hash = manifest_hash(r->data.data, r->data.len);
+
+	return true;
+}
+
+/*
+ * Key of the comparison of filename and filename2 in the cache. The
+ * referenced files matter when they are followed: the key is then made of
+ * the checksums of the manifests.
+ */
+static bool compare_cache_key(const char *filename, const char *filename2,
+			      struct cache_key *key, struct compare_read *r1,
+			      struct compare_read *r2)
+{
+	compare_config_t *conf = &compare_config;
+
+	if (conf->cache == NULL || conf->debug || conf->new_objs != NULL)
+		return false;
+
+	if (conf->follow) {
+		if (!manifest_lookup(conf->old_manifest, filename, true,
+				     &key->old_hash) ||
+		    !manifest_lookup(conf->new_manifest, filename2, true,
+				     &key->new_hash))
+			return false;
+	} else if (!compare_file_hash(conf->old_dir, conf->old_ar,
+				      conf->old_manifest, filename,
+				      &key->old_hash, r1) ||
+		   !compare_file_hash(conf->new_dir, conf->new_ar,
+				      conf->new_manifest, filename2,
+				      &key->new_hash, r2)) {
+		return false;
+	}
+	key->options = compare_options_hash();
+
+	return true;
+}
+
+/*
+ * A file of the old dump is missing from the new one. An incomplete
+ * definition going away is not a change.
+ */
+static int compare_file_removed(const char *filename)
+{
+	if (strncmp(filename, DECLARATION_PATH,
+		    strlen(DECLARATION_PATH)) == 0 ||
+	    compare_config.no_moved_files)
+		return 0;
+
+	compare_report(KABI_DW_REMOVED, filename, NULL);
+
+	return EXIT_KABI_CHANGE;
+}
+
+/* A file of the new dump is missing from the old one: not a change */
+static void compare_file_added(const char *filename)
+{
+	if (strncmp(filename, DECLARATION_PATH,
+		    strlen(DECLARATION_PATH)) == 0 ||
+	    compare_config.no_moved_files)
+		return;
+
+	compare_report(KABI_DW_ADDED, filename, NULL);
+}
+
+/* Streams of the comparisons, created once, see compare_stream() */
+static FILE *compare_null;	/* discards the followed files output */
+static FILE *compare_out;	/* to compare_buf */
+static struct buffer compare_buf;
+
+static ssize_t compare_null_write(void *cookie, const char *data,
+				  size_t len)
+{
+	return len;
+}
+
+static ssize_t compare_buf_write(void *cookie, const char *data, size_t len)
+{
+	buffer_put(cookie, data, len);
+
+	return len;
+}
+
+/*
+ * The stream the comparison of a file prints its report to: compare_buf,
+ * emptied, or nothing for a followed file.
+ */
+static FILE *compare_stream(bool follow)
+{
+	cookie_io_functions_t null_io = { .write = compare_null_write };
+	cookie_io_functions_t buf_io = { .write = compare_buf_write };
+
+	if (compare_null == NULL) {
+		compare_null = fopencookie(NULL, "w", null_io);
+		buffer_init(&compare_buf);
+		compare_out = fopencookie(&compare_buf, "w", buf_io);
+		if (compare_null == NULL || compare_out == NULL)
+			fail("Cannot open the report streams: %s\n",
+			     strerror(errno));
+	}
+
+	if (follow)
+		return compare_null;
+
+	fflush(compare_out);
+	buffer_reset(&compare_buf);
+
+	return compare_out;
+}
+
+/* The report printed to compare_out, as a string */
+static char *compare_stream_report(void)
+{
+	fflush(compare_out);
+	buffer_putc(&compare_buf, '\0');
+
+	return compare_buf.data;
+}
+
 /*
  * Parse two files and compare the resulting tree.
  *
@@ -577,13 +1080,12 @@ static int compare_two_files(const char *filename, const char *newfile,
 			     bool follow)
 {
 	obj_t *root1, *root2;
-	char *old_dir = compare_config.old_dir;
-	char *new_dir = compare_config.new_dir;
-	char *path1, *path2, *s = NULL;
-	const char *filename2;
-	FILE *file1, *file2, *stream;
-	struct stat fstat;
-	size_t sz;
+	char *s = NULL;
+	const char *filename2, *report;
+	struct compare_read r1 = { .path = NULL }, r2 = { .path = NULL };
+	struct cache_key key;
+	bool to_cache = false;
+	FILE *stream;
 	int ret = 0, tmp;
 
 	if (follow && !compare_config.follow)
@@ -593,98 +1095,572 @@ static int compare_two_files(const char *filename, const char *newfile,
 	if (!push_file(filename))
 		return 0;
 
-	safe_asprintf(&path1, "%s/%s", old_dir, filename);
 	filename2 = newfile ? newfile : filename;
-	safe_asprintf(&path2, "%s/%s", new_dir, filename2);
-
-	if (stat(path2, &fstat) != 0) {
-		if (errno == ENOENT) {
-			/* Don't consider an incomplete definition a change */
-			if (strncmp(filename2, DECLARATION_PATH,
-				    strlen(DECLARATION_PATH)) &&
-			    !compare_config.no_moved_files) {
-				ret = EXIT_KABI_CHANGE;
-				printf("Symbol removed or moved: %s\n",
-				       filename);
-			}
 
-			free(path1);
-			free(path2);
+	if (compare_unchanged(filename, filename2))
+		return 0;
 
+	/* the followed files are not cached, their verdicts depend on
+	 * the files followed before them */
+	if (!follow && compare_cache_key(filename, filename2, &key, &r1, &r2)) {
+		if (cache_find(compare_config.cache, &key, &ret, &report)) {
+			compare_read_free(&r1);
+			compare_read_free(&r2);
+			if (report != NULL)
+				compare_report(KABI_DW_CHANGED, filename,
+					       report);
 			return ret;
-		} else {
-			fail("Failed to stat() file%s: %s\n",
-			     path2, strerror(errno));
 		}
+		to_cache = true;
 	}
 
-	file1 = safe_fopen(path1);
-	file2 = safe_fopen(path2);
-
-	root1 = obj_parse(file1, path1);
-	root2 = obj_parse(file2, path2);
-
-	free(path1);
-	free(path2);
-
-	if (compare_config.hide_kabi) {
-		obj_hide_kabi(root1, compare_config.hide_kabi_new);
-		obj_hide_kabi(root2, compare_config.hide_kabi_new);
+	/* Loading the new file first tells if it still exists */
+	root2 = compare_load_new(filename2, &r2);
+	if (root2 == NULL) {
+		compare_read_free(&r1);
+		return compare_file_removed(filename);
 	}
 
+	root1 = compare_load_old(filename, &r1);
+	compare_read_free(&r1);
+
 	if (compare_config.debug && !follow) {
 		obj_debug_tree(root1);
 		obj_debug_tree(root2);
 	}
 
-	if (follow) {
-		stream = fopen("/dev/null", "w");
-		if (stream == NULL)
-			fail("Unable to open /dev/null: %s\n", strerror(errno));
-	} else {
-		stream = open_memstream(&s, &sz);
-	}
+	stream = compare_stream(follow);
 	tmp = compare_tree(root1, root2, stream);
 
 	if (tmp != COMP_SAME) {
 		if (!follow) {
-			printf("Changes detected in: %s\n", filename);
-			fflush(stream);
-			fputs(s, stdout);
-			putchar('\n');
+			s = compare_stream_report();
+			compare_report(KABI_DW_CHANGED, filename, s);
 		}
 		ret = EXIT_KABI_CHANGE;
 	}
+	if (to_cache)
+		cache_add(compare_config.cache, &key, ret,
+			  ret != 0 ? s : NULL);
 
-	obj_free(root1);
-	obj_free(root2);
-	fclose(file1);
-	fclose(file2);
-	fclose(stream);
-	free(s);
+	if (compare_config.old_objs == NULL)
+		obj_free(root1);
+	if (compare_config.new_objs == NULL)
+		obj_free(root2);
 
 	return ret;
 
 }
 
+/* Number of files read ahead of the compared one */
+#define COMPARE_PREFETCH 16
+
+/* The files of a dump, sorted by archive_name_cmp() */
+struct compare_files {
+	char **names;
+	size_t count;
+	size_t size;
+	char *dir;	/* stripped from the walked paths, NULL if none */
+};
+
+static void compare_files_add(struct compare_files *files,
+			      const char *filename)
+{
+	const char *base = strrchr(filename, '/');
+
+	if (compare_config.skip_duplicate && is_duplicate((char *)filename))
+		return;
+
+	base = base != NULL ? base + 1 : filename;
+	if (strcmp(base, MANIFEST_FILE) == 0 ||
+	    strcmp(base, CHECKSUMS_FILE) == 0 ||
+	    strcmp(base, DEPENDENTS_FILE) == 0)
+		return;
+
+	if (files->count == files->size) {
+		files->size = files->size ? files->size * 2 : 1024;
+		files->names = safe_realloc(files->names, files->size *
+					    sizeof(*files->names));
+	}
+	files->names[files->count++] = safe_strdup(filename);
+}
+
 static walk_rv_t compare_files_cb(char *kabi_path, void *arg)
 {
-	compare_config_t *conf = (compare_config_t *)arg;
+	struct compare_files *files = arg;
 	char *filename;
 
-	if (compare_config.skip_duplicate && is_duplicate(kabi_path))
-		return WALK_CONT;
+	/* If the dir contains slashes, skip them */
+	filename = kabi_path;
+	if (files->dir != NULL) {
+		filename += strlen(files->dir);
+		while (*filename == '/')
+			filename++;
+	}
+	compare_files_add(files, filename);
+
+	return WALK_CONT;
+}
 
-	/* If conf->*_dir contains slashes, skip them */
-	filename = kabi_path + strlen(conf->old_dir);
-	while (*filename == '/')
-		filename++;
+static int compare_name_cmp(const void *a, const void *b)
+{
+	return archive_name_cmp(*(char * const *)a, *(char * const *)b);
+}
 
-	free_files();
-	if (compare_two_files(filename, NULL, false))
-		conf->ret = EXIT_KABI_CHANGE;
+static void compare_prefetch(const char *filename)
+{
+	if (compare_unchanged(filename, filename))
+		return;
 
-	return WALK_CONT;
+	if (compare_config.old_ar == NULL && compare_config.old_objs == NULL)
+		kabi_prefetch(compare_config.old_dir, filename);
+	if (compare_config.new_ar == NULL && compare_config.new_objs == NULL)
+		kabi_prefetch(compare_config.new_dir, filename);
+}
+
+/* List the files of the dump dir or ar, sorted */
+static void compare_list_dump(char *dir, struct archive *ar,
+			      struct compare_files *files)
+{
+	if (ar != NULL) {
+		archive_walk(ar, compare_files_cb, files);
+	} else {
+		files->dir = dir;
+		walk_dir(dir, false, compare_files_cb, files);
+	}
+
+	qsort(files->names, files->count, sizeof(*files->names),
+	      compare_name_cmp);
+}
+
+/* List the files of the old dump */
+static void compare_list_files(struct compare_files *files)
+{
+	compare_list_dump(compare_config.old_dir, compare_config.old_ar,
+			  files);
+}
+
+/* List the files of the new dump, or of the trees kept in memory */
+static void compare_list_new(struct compare_files *files)
+{
+	struct hash_iter iter;
+	const char *name;
+	const void *root;
+
+	if (compare_config.new_objs == NULL) {
+		compare_list_dump(compare_config.new_dir,
+				  compare_config.new_ar, files);
+		return;
+	}
+
+	hash_iter_init(compare_config.new_objs, &iter);
+	while (hash_iter_next(&iter, &name, &root))
+		compare_files_add(files, name);
+	qsort(files->names, files->count, sizeof(*files->names),
+	      compare_name_cmp);
+}
+
+static void compare_free_files(struct compare_files *files)
+{
+	size_t i;
+
+	for (i = 0; i < files->count; i++)
+		free(files->names[i]);
+	free(files->names);
+}
+
+/*
+ * Compare the listed files of the old dump to the new dump. Both listings
+ * are sorted: a single pass over them tells the files removed, added and
+ * common to both, only the latter are read. The files are listed first,
+ * so that the next ones are read while one is compared.
+ */
+static void compare_listed_files(struct compare_files *files)
+{
+	struct compare_files new_files = { NULL, 0, 0, NULL };
+	size_t i = 0, j = 0, next = 0;
+	int cmp;
+
+	compare_list_new(&new_files);
+
+	while (i < files->count || j < new_files.count) {
+		if (i == files->count)
+			cmp = 1;
+		else if (j == new_files.count)
+			cmp = -1;
+		else
+			cmp = archive_name_cmp(files->names[i],
+					       new_files.names[j]);
+
+		if (cmp > 0) {
+			compare_file_added(new_files.names[j++]);
+			continue;
+		}
+		if (cmp < 0) {
+			if (compare_file_removed(files->names[i++]))
+				compare_config.ret = EXIT_KABI_CHANGE;
+			continue;
+		}
+
+		for (; next < files->count && next <= i + COMPARE_PREFETCH;
+		     next++)
+			compare_prefetch(files->names[next]);
+
+		clear_files();
+		if (compare_two_files(files->names[i], NULL, false))
+			compare_config.ret = EXIT_KABI_CHANGE;
+		i++;
+		j++;
+	}
+
+	compare_free_files(&new_files);
+}
+
+/* Compare all the files of the old dump */
+static void compare_files(void)
+{
+	struct compare_files files = { NULL, 0, 0, NULL };
+
+	compare_list_files(&files);
+	compare_listed_files(&files);
+	compare_free_files(&files);
+}
+
+/*
+ * Parse all the files of the dump dir and keep them, with its manifest,
+ * for the comparisons run later by this process or its children. The
+ * files are parsed with the given kABI hiding options, which the
+ * comparisons must then use.
+ */
+void compare_load_baseline(char *dir, bool hide_kabi, bool hide_kabi_new)
+{
+	struct compare_files files = { NULL, 0, 0, NULL };
+	struct compare_baseline *b;
+	struct stat sb;
+	char *path;
+	size_t i;
+
+	path = realpath(dir, NULL);
+	if (path == NULL)
+		fail("Cannot find '%s': %s\n", dir, strerror(errno));
+	if (!is_archive(path) && (stat(path, &sb) < 0 || !S_ISDIR(sb.st_mode)))
+		fail("'%s' is neither a kabi directory nor an archive\n", dir);
+
+	baselines = safe_realloc(baselines,
+				 (nbaselines + 1) * sizeof(*baselines));
+	b = &baselines[nbaselines++];
+	b->path = path;
+	b->ar = is_archive(path) ? archive_open(path) : NULL;
+	b->manifest = manifest_load(path, b->ar);
+	b->objs = hash_new(COMPARE_OBJS_SIZE, (void (*)(void *))obj_free);
+	if (b->objs == NULL)
+		fail("Cannot create the parsed files hash\n");
+	b->hide_kabi = hide_kabi;
+	b->hide_kabi_new = hide_kabi_new;
+
+	compare_config.old_dir = b->path;
+	compare_config.old_ar = b->ar;
+	compare_config.old_objs = b->objs;
+	compare_config.hide_kabi = hide_kabi;
+	compare_config.hide_kabi_new = hide_kabi_new;
+
+	compare_list_files(&files);
+	for (i = 0; i < files.count; i++)
+		compare_load_old(files.names[i], NULL);
+	compare_free_files(&files);
+
+	compare_config.old_dir = NULL;
+	compare_config.old_ar = NULL;
+	compare_config.old_objs = NULL;
+	compare_config.hide_kabi = false;
+	compare_config.hide_kabi_new = false;
+}
+
+/* Set up the old dump, taken from memory if serve keeps it */
+static void compare_open_old(char *old_dir)
+{
+	struct compare_baseline *b = compare_find_baseline(old_dir);
+
+	compare_config.old_dir = old_dir;
+
+	if (b == NULL) {
+		if (is_archive(old_dir))
+			compare_config.old_ar = archive_open(old_dir);
+		compare_config.old_manifest =
+			manifest_load(old_dir, compare_config.old_ar);
+		return;
+	}
+
+	if (b->hide_kabi != compare_config.hide_kabi ||
+	    b->hide_kabi_new != compare_config.hide_kabi_new)
+		fail("%s is kept with other kABI hiding options\n", old_dir);
+
+	compare_config.baseline = b;
+	compare_config.old_ar = b->ar;
+	compare_config.old_manifest = b->manifest;
+	compare_config.old_objs = b->objs;
+}
+
+static int uint_cmp(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *)a;
+	unsigned int y = *(const unsigned int *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Report each changed file once, followed by the exported symbols that
+ * reach it through references.
+ *
+ * The changed files are found with the manifests and the impacted symbols
+ * by walking up the reverse references of the old dump, so nothing is
+ * parsed but the changed files.
+ */
+static void compare_impact(void)
+{
+	struct manifest *m = compare_config.old_manifest;
+	unsigned int count = manifest_count(m);
+	unsigned int *seen = safe_zmalloc(count * sizeof(*seen));
+	unsigned int *queue = safe_zmalloc(count * sizeof(*queue));
+	unsigned int *symbols = safe_zmalloc(count * sizeof(*symbols));
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		const char *name = manifest_name(m, i);
+		unsigned int head = 0, tail = 0, nsymbols = 0, j;
+
+		if (compare_config.skip_duplicate && is_duplicate((char *)name))
+			continue;
+		if (manifest_same(m, name, compare_config.new_manifest, name,
+				  false))
+			continue;
+
+		clear_files();
+		if (compare_two_files(name, NULL, false) == 0)
+			continue;
+		compare_config.ret = EXIT_KABI_CHANGE;
+
+		seen[i] = i + 1;
+		queue[tail++] = i;
+		while (head < tail) {
+			unsigned int v = queue[head++];
+			const unsigned int *deps;
+			unsigned int n, d;
+
+			if (is_symbol_file(manifest_name(m, v)))
+				symbols[nsymbols++] = v;
+
+			n = manifest_dependents(m, v, &deps);
+			for (d = 0; d < n; d++) {
+				if (seen[deps[d]] == i + 1)
+					continue;
+				seen[deps[d]] = i + 1;
+				queue[tail++] = deps[d];
+			}
+		}
+
+		if (nsymbols == 0)
+			continue;
+
+		qsort(symbols, nsymbols, sizeof(*symbols), uint_cmp);
+		printf("Impacted symbols:\n");
+		for (j = 0; j < nsymbols; j++) {
+			char *symbol = filenametosymbol(manifest_name(m,
+							symbols[j]));
+
+			printf("\t%s\n", symbol);
+			free(symbol);
+		}
+		putchar('\n');
+	}
+
+	free(symbols);
+	free(queue);
+	free(seen);
+}
+
+static void compare_check_impact(void)
+{
+	if (compare_config.old_manifest == NULL ||
+	    compare_config.new_manifest == NULL ||
+	    !manifest_has_dependents(compare_config.old_manifest))
+		fail("--impact needs dumps with a manifest\n");
+}
+
+/* A dump compared to the old one in batch mode */
+struct compare_job {
+	char *new_dir;
+	FILE *report;	/* standard output of the comparison */
+	pid_t pid;
+	int status;
+	bool done;
+};
+
+/* Compare the listed files of the old dump to new_dir, in a child process */
+static int compare_to(char *new_dir, struct compare_files *files)
+{
+	compare_config.new_dir = new_dir;
+	if (is_archive(new_dir))
+		compare_config.new_ar = archive_open(new_dir);
+	compare_config.new_manifest = manifest_load(new_dir,
+						    compare_config.new_ar);
+
+	if (compare_config.impact) {
+		compare_check_impact();
+		compare_impact();
+	} else {
+		compare_listed_files(files);
+	}
+
+	return compare_config.ret;
+}
+
+static void compare_job_start(struct compare_job *job,
+			      struct compare_files *files)
+{
+	job->report = tmpfile();
+	if (job->report == NULL)
+		fail("Cannot create a temporary file: %s\n", strerror(errno));
+
+	/* don't let the child print what is buffered */
+	fflush(stdout);
+	job->pid = fork();
+	if (job->pid < 0)
+		fail("Cannot fork: %s\n", strerror(errno));
+
+	if (job->pid == 0) {
+		int ret;
+
+		if (dup2(fileno(job->report), STDOUT_FILENO) < 0)
+			fail("Cannot redirect the output: %s\n",
+			     strerror(errno));
+		ret = compare_to(job->new_dir, files);
+		fflush(stdout);
+		_exit(ret);
+	}
+}
+
+/* Print the report of a finished job, return false if the job failed */
+static bool compare_job_report(struct compare_job *job)
+{
+	char buf[4096];
+	size_t n;
+
+	printf("Comparing with: %s\n", job->new_dir);
+	rewind(job->report);
+	while ((n = fread(buf, 1, sizeof(buf), job->report)) > 0)
+		fwrite(buf, 1, n, stdout);
+	fclose(job->report);
+
+	if (!WIFEXITED(job->status))
+		return false;
+	switch (WEXITSTATUS(job->status)) {
+	case 0:
+		return true;
+	case EXIT_KABI_CHANGE:
+		compare_config.ret = EXIT_KABI_CHANGE;
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Compare the old dump to each of the count dumps in new_dirs.
+ *
+ * The files of the old dump are parsed once, before forking a process per
+ * new dump: the processes share the parsed trees. Up to compare_config.jobs
+ * of them run at the same time. Their reports are printed in the order of
+ * new_dirs.
+ */
+static void compare_batch(char **new_dirs, unsigned int count)
+{
+	struct compare_files files = { NULL, 0, 0, NULL };
+	struct compare_job *jobs = safe_zmalloc(count * sizeof(*jobs));
+	unsigned int i, next = 0, running = 0, printed = 0;
+	bool failed = false;
+
+	for (i = 0; i < count; i++)
+		jobs[i].new_dir = new_dirs[i];
+
+	if (compare_config.old_objs == NULL)
+		compare_config.old_objs = hash_new(COMPARE_OBJS_SIZE,
+					(void (*)(void *))obj_free);
+	if (compare_config.old_objs == NULL)
+		fail("Cannot create the parsed files hash\n");
+
+	compare_list_files(&files);
+	if (!compare_config.impact) {
+		for (i = 0; i < files.count; i++)
+			compare_load_old(files.names[i], NULL);
+	}
+
+	while (printed < count) {
+		int status;
+		pid_t pid;
+
+		for (; next < count && running < compare_config.jobs; next++) {
+			compare_job_start(&jobs[next], &files);
+			running++;
+		}
+
+		pid = waitpid(-1, &status, 0);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			fail("Cannot wait for the comparisons: %s\n",
+			     strerror(errno));
+		}
+		for (i = 0; i < next; i++) {
+			if (jobs[i].pid == pid) {
+				jobs[i].status = status;
+				jobs[i].done = true;
+				running--;
+			}
+		}
+
+		for (; printed < count && jobs[printed].done; printed++) {
+			if (!compare_job_report(&jobs[printed])) {
+				fprintf(stderr, "Comparing with %s failed\n",
+					jobs[printed].new_dir);
+				failed = true;
+			}
+		}
+	}
+
+	compare_free_files(&files);
+	free(jobs);
+
+	if (failed)
+		compare_config.ret = 1;
+}
+
+/*
+ * Free what compare_open_old() and the comparisons have set up. The library
+ * also calls it when a comparison fails.
+ */
+void compare_close(void)
+{
+	/* a dump kept by serve stays for the next comparisons */
+	if (compare_config.baseline == NULL) {
+		hash_free(compare_config.old_objs);
+		manifest_free(compare_config.old_manifest);
+		if (compare_config.old_ar != NULL)
+			archive_close(compare_config.old_ar);
+	}
+	compare_config.old_objs = NULL;
+	compare_config.old_manifest = NULL;
+	compare_config.old_ar = NULL;
+	manifest_free(compare_config.new_manifest);
+	compare_config.new_manifest = NULL;
+	if (compare_config.new_ar != NULL)
+		archive_close(compare_config.new_ar);
+	compare_config.new_ar = NULL;
+	cache_close(compare_config.cache);
+	compare_config.cache = NULL;
+	hash_free(compare_config.followed);
+	compare_config.followed = NULL;
 }
 
 #define COMPARE_NO_OPT(name) \
@@ -714,12 +1690,20 @@ int compare(int argc, char **argv)
 		COMPARE_NO_OPT(removed),
 		{"no-moved-files", no_argument,
 		 &compare_config.no_moved_files, 1},
+		{"impact", no_argument, &compare_config.impact, 1},
+		{"batch", no_argument, &compare_config.batch, 1},
+		{"jobs", required_argument, 0, 'j'},
+		{"cache", required_argument, 0, 'c'},
 		{0, 0, 0, 0}
 	};
+	char *end;
+	long jobs;
 
 	memset(&display_options, 0, sizeof(display_options));
+	jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	compare_config.jobs = jobs > 0 ? jobs : 1;
 
-	while ((opt = getopt_long(argc, argv, "dknhs",
+	while ((opt = getopt_long(argc, argv, "dknhsj:",
 				  loptions, &opt_index)) != -1) {
 		switch (opt) {
 		case 0:
@@ -736,6 +1720,17 @@ int compare(int argc, char **argv)
 		case 's':
 			compare_config.skip_duplicate = true;
 			break;
+		case 'j':
+			jobs = strtol(optarg, &end, 10);
+			if (*end != '\0' || jobs < 1) {
+				printf("Invalid number of jobs: %s\n", optarg);
+				compare_usage();
+			}
+			compare_config.jobs = jobs;
+			break;
+		case 'c':
+			compare_config.cache_path = optarg;
+			break;
 		case 'h':
 		default:
 			compare_usage();
@@ -747,13 +1742,39 @@ int compare(int argc, char **argv)
 		compare_usage();
 	}
 
+	if (compare_config.cache_path != NULL)
+		compare_config.cache = cache_open(compare_config.cache_path);
+
+	if (compare_config.batch) {
+		int i;
+
+		for (i = optind; i < argc; i++) {
+			if (stat(argv[i], &sb1) == -1)
+				fail("stat failed: %s: %s\n", argv[i],
+				     strerror(errno));
+			if (!is_archive(argv[i]) && !S_ISDIR(sb1.st_mode)) {
+				printf("--batch takes directories as arguments"
+				       "\n");
+				compare_usage();
+			}
+		}
+
+		compare_open_old(argv[optind++]);
+		compare_batch(argv + optind, argc - optind);
+		goto out;
+	}
+
 	old_dir = compare_config.old_dir = argv[optind++];
 	new_dir = compare_config.new_dir = argv[optind++];
 
 	if ((stat(old_dir, &sb1) == -1) || (stat(new_dir, &sb2) == -1))
 		fail("stat failed: %s\n", strerror(errno));
 
-	if (S_ISREG(sb1.st_mode) && S_ISREG(sb2.st_mode)) {
+	if (is_archive(new_dir))
+		compare_config.new_ar = archive_open(new_dir);
+
+	if (!is_archive(old_dir) && compare_config.new_ar == NULL &&
+	    S_ISREG(sb1.st_mode) && S_ISREG(sb2.st_mode)) {
 		char *oldname = basename(old_dir);
 		char *newname = basename(new_dir);
 
@@ -767,16 +1788,30 @@ int compare(int argc, char **argv)
 		return compare_two_files(oldname, newname, false);
 	}
 
-	if (!S_ISDIR(sb1.st_mode) || !S_ISDIR(sb2.st_mode)) {
+	if ((!is_archive(old_dir) && !S_ISDIR(sb1.st_mode)) ||
+	    (compare_config.new_ar == NULL && !S_ISDIR(sb2.st_mode))) {
 		printf("Compare takes two directories or two regular"
 		       " files as arguments\n");
 		compare_usage();
 	}
 
-	if (optind == argc) {
-		walk_dir(old_dir, false, compare_files_cb, &compare_config);
+	compare_open_old(old_dir);
+	compare_config.new_manifest = manifest_load(new_dir,
+						    compare_config.new_ar);
 
-		return compare_config.ret;
+	if (compare_config.impact) {
+		if (optind != argc) {
+			printf("--impact compares whole dumps\n");
+			compare_usage();
+		}
+		compare_check_impact();
+		compare_impact();
+		goto out;
+	}
+
+	if (optind == argc) {
+		compare_files();
+		goto out;
 	}
 
 	while (optind < argc) {
@@ -785,13 +1820,16 @@ int compare(int argc, char **argv)
 		filename = compare_config.filename =  argv[optind++];
 		safe_asprintf(&path, "%s/%s", old_dir, filename);
 
-		if (stat(path, &sb1) == -1) {
+		if (compare_config.old_ar != NULL) {
+			if (!archive_contains(compare_config.old_ar, filename))
+				fail("file does not exist: %s\n", path);
+		} else if (stat(path, &sb1) == -1) {
 			if (errno == ENOENT)
 				fail("file does not exist: %s\n", path);
 			fail("stat failed: %s\n", strerror(errno));
 		}
 
-		if (!S_ISREG(sb1.st_mode)) {
+		if (compare_config.old_ar == NULL && !S_ISREG(sb1.st_mode)) {
 			printf("Compare third argument must be a regular file");
 			compare_usage();
 		}
@@ -801,5 +1839,79 @@ int compare(int argc, char **argv)
 			compare_config.ret = EXIT_KABI_CHANGE;
 	}
 
+out:
+	compare_close();
+
 	return compare_config.ret;
 }
+
+/* Set compare_config up for the library: the changes go to diff */
+static void compare_setup(const struct kabi_dw_compare_options *opts,
+			  struct kabi_dw_diff *diff)
+{
+	memset(&compare_config, 0, sizeof(compare_config));
+	memset(&display_options, 0, sizeof(display_options));
+	compare_config.hide_kabi = opts->hide_kabi || opts->hide_kabi_new;
+	compare_config.hide_kabi_new = opts->hide_kabi_new;
+	compare_config.skip_duplicate = opts->skip_duplicate;
+	compare_config.follow = opts->follow;
+	compare_config.no_replaced = opts->no_replaced;
+	compare_config.no_shifted = opts->no_shifted;
+	compare_config.no_inserted = opts->no_inserted;
+	compare_config.no_deleted = opts->no_deleted;
+	compare_config.no_added = opts->no_added;
+	compare_config.no_removed = opts->no_removed;
+	compare_config.no_moved_files = opts->no_moved_files;
+	display_options.no_offset = opts->no_offset;
+	compare_config.result = diff;
+}
+
+static void compare_check_dump(char *dir)
+{
+	struct stat sb;
+
+	if (!is_archive(dir) && (stat(dir, &sb) < 0 || !S_ISDIR(sb.st_mode)))
+		fail("'%s' is neither a kabi directory nor an archive\n", dir);
+}
+
+/* Compare the dumps old_dir and new_dir for the library */
+void compare_dumps(char *old_dir, char *new_dir,
+		   const struct kabi_dw_compare_options *opts,
+		   struct kabi_dw_diff *diff)
+{
+	compare_setup(opts, diff);
+	compare_check_dump(old_dir);
+	compare_check_dump(new_dir);
+
+	compare_config.new_dir = new_dir;
+	if (is_archive(new_dir))
+		compare_config.new_ar = archive_open(new_dir);
+	compare_open_old(old_dir);
+	compare_config.new_manifest = manifest_load(new_dir,
+						    compare_config.new_ar);
+
+	compare_files();
+	compare_close();
+}
+
+/*
+ * Compare the dump old_dir to the trees of new_objs, indexed by the names
+ * of their files, which generate has kept in memory instead of writing
+ * them. The trees share subtrees and must not be modified: the kABI
+ * trickery can't be hidden in them.
+ */
+void compare_trees(char *old_dir, struct hash *new_objs,
+		   const struct kabi_dw_compare_options *opts,
+		   struct kabi_dw_diff *diff)
+{
+	compare_setup(opts, diff);
+	compare_check_dump(old_dir);
+	compare_config.hide_kabi = false;
+	compare_config.hide_kabi_new = false;
+
+	compare_config.new_objs = new_objs;
+	compare_open_old(old_dir);
+
+	compare_files();
+	compare_close();
+}
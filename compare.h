@@ -18,9 +18,24 @@
 #ifndef KABI_DW_COMAPRE_H_
 #define KABI_DW_COMAPRE_H_
 
+#include <stdbool.h>
+
+struct kabi_dw_compare_options;
+struct kabi_dw_diff;
+struct hash;
+
 /* Return value when we detect a kABI change */
 #define EXIT_KABI_CHANGE 2
 
 int compare(int argc, char **argv);
+void compare_load_baseline(char *dir, bool hide_kabi, bool hide_kabi_new);
+void compare_dumps(char *old_dir, char *new_dir,
+		   const struct kabi_dw_compare_options *opts,
+		   struct kabi_dw_diff *diff);
+void compare_trees(char *old_dir, struct hash *new_objs,
+		   const struct kabi_dw_compare_options *opts,
+		   struct kabi_dw_diff *diff);
+void compare_close(void);
+void compare_print_diff(struct kabi_dw_diff *diff);
 
 #endif
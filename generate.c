@@ -36,6 +36,7 @@
 #include <assert.h>
 #include <getopt.h>
 #include <limits.h>
+#include <pthread.h>
 
 #include <elfutils/libdw.h>
 #include <elfutils/libdwfl.h>
@@ -50,6 +51,11 @@
 #include "objects.h"
 #include "list.h"
 #include "record.h"
+#include "buffer.h"
+#include "archive.h"
+#include "manifest.h"
+#include "compare.h"
+#include "kabi-dw.h"
 
 #define	EMPTY_NAME	"(NULL)"
 #define PROCESSED_SIZE 1024
@@ -69,18 +75,6 @@
 #endif
 
 struct set;
-struct record_db;
-
-typedef struct {
-	char *kernel_dir; /* Path to  the kernel modules to process */
-	char *kabi_dir; /* Where to put the output */
-	struct ksymtab *symbols; /* List of symbols to generate */
-	size_t symbol_cnt;
-	struct record_db *db;
-	bool rhel_tree;
-	bool verbose;
-	bool gen_extra;
-} generate_config_t;
 
 struct cu_ctx {
 	generate_config_t *conf;
@@ -568,9 +562,246 @@ static void set_free(struct set *set)
 	hash_free(h);
 }
 
+/*
+ * Memo of the record pairs compared by record_same_declarations()
+ *
+ * The same pairs of records, such as the versions of a structure reached
+ * from many others, are compared over and over again while merging.
+ * Within a comparison, a record already visited is assumed to be the same,
+ * which cuts the recursion on cyclic references but makes some verdicts
+ * depend on the path. Only the verdicts which don't are kept:
+ * - the "different" ones, since the assumption only turns verdicts into
+ *   "same";
+ * - the "same" ones reached without the assumption, or assuming only the
+ *   pairs being compared (a cycle), once the first of these is the same.
+ *
+ * Merging changes the merged records and the records referencing them: a
+ * merged or freed record drops the verdicts of its pairs, and the verdicts
+ * which used them.
+ */
+#define SAME_DECL_SIZE (64 * 1024)
+#define SAME_DECL_NONE UINT_MAX
+
+enum same_decl_state {
+	SAME_DECL_ACTIVE,	/* being compared */
+	SAME_DECL_PENDING,	/* same if the pair it assumes is */
+	SAME_DECL_GUESSED,	/* depends on the path */
+	SAME_DECL_KEPT,		/* in same_decl_pairs */
+};
+
+struct same_decl_key {
+	struct record *r1;
+	struct record *r2;
+};
+
+struct same_decl_keys {
+	struct same_decl_key *keys;
+	unsigned int count;
+	unsigned int size;
+};
+
+struct same_decl_pair {
+	struct same_decl_key key;
+	bool same;
+	enum same_decl_state state;
+	unsigned int depth;		/* in the comparison */
+	unsigned int low;		/* of the shallowest pair assumed */
+	struct same_decl_keys users;	/* pairs whose verdicts used it */
+	struct same_decl_pair *pending;	/* next in same_decl_cache */
+	struct same_decl_pair *visited;	/* next in same_decl_cache */
+};
+
+/* The pairs of a record, some of them may be gone */
+struct same_decl_refs {
+	struct record *rec;		/* key */
+	struct same_decl_keys pairs;
+};
+
+/* The verdicts kept, by pair and by record */
+static struct hash *same_decl_pairs;
+static struct hash *same_decl_records;
+
+/* A comparison of record_same_declarations_cached() */
+struct same_decl_cache {
+	struct hash *processed;		/* key of r1 -> its first pair */
+	struct same_decl_pair *top;	/* pair being compared */
+	unsigned int depth;
+	struct same_decl_pair *pending;	/* waiting for the pair they assume */
+	struct same_decl_pair *visited;	/* all the pairs compared */
+};
+
+static void same_decl_keys_add(struct same_decl_keys *k,
+			       const struct same_decl_key *key)
+{
+	if (k->count == k->size) {
+		k->size = k->size ? k->size * 2 : 4;
+		k->keys = safe_realloc(k->keys, k->size * sizeof(*k->keys));
+	}
+	k->keys[k->count++] = *key;
+}
+
+static void same_decl_pair_free(void *value)
+{
+	struct same_decl_pair *pair = value;
+
+	free(pair->users.keys);
+	free(pair);
+}
+
+static void same_decl_refs_free(void *value)
+{
+	struct same_decl_refs *refs = value;
+
+	free(refs->pairs.keys);
+	free(refs);
+}
+
+static void same_decl_init(void)
+{
+	if (same_decl_pairs != NULL)
+		return;
+
+	same_decl_pairs = hash_new(SAME_DECL_SIZE, same_decl_pair_free);
+	same_decl_records = hash_new(SAME_DECL_SIZE, same_decl_refs_free);
+	if (same_decl_pairs == NULL || same_decl_records == NULL)
+		fail("Cannot create hash");
+}
+
+static void same_decl_free(void)
+{
+	hash_free(same_decl_pairs);
+	hash_free(same_decl_records);
+	same_decl_pairs = NULL;
+	same_decl_records = NULL;
+}
+
+static void same_decl_record_add(struct record *rec,
+				 const struct same_decl_key *key)
+{
+	struct same_decl_refs *refs;
+
+	refs = hash_find_bin(same_decl_records, (const char *)&rec,
+			     sizeof(rec));
+	if (refs == NULL) {
+		refs = safe_zmalloc(sizeof(*refs));
+		refs->rec = rec;
+		if (hash_add_bin(same_decl_records, (const char *)&refs->rec,
+				 sizeof(refs->rec), refs) < 0)
+			fail("Cannot add to the compared records\n");
+	}
+	same_decl_keys_add(&refs->pairs, key);
+}
+
+static void same_decl_keep(struct same_decl_pair *pair)
+{
+	pair->state = SAME_DECL_KEPT;
+	if (hash_add_bin(same_decl_pairs, (const char *)&pair->key,
+			 sizeof(pair->key), pair) < 0)
+		fail("Cannot add to the compared pairs\n");
+	same_decl_record_add(pair->key.r1, &pair->key);
+	same_decl_record_add(pair->key.r2, &pair->key);
+}
+
+/* Drop the verdict of the pair, and of the pairs which used it */
+static void same_decl_drop(const struct same_decl_key *key)
+{
+	struct same_decl_pair *pair;
+	struct same_decl_keys users;
+	unsigned int i;
+
+	pair = hash_find_bin(same_decl_pairs, (const char *)key, sizeof(*key));
+	if (pair == NULL)
+		return;
+
+	users = pair->users;
+	pair->users.keys = NULL;
+	hash_del_bin(same_decl_pairs, (const char *)key, sizeof(*key));
+
+	for (i = 0; i < users.count; i++)
+		same_decl_drop(&users.keys[i]);
+	free(users.keys);
+}
+
+/* rec is merged or freed: its verdicts no longer hold */
+static void same_decl_forget(struct record *rec)
+{
+	struct same_decl_refs *refs;
+	unsigned int i;
+
+	if (same_decl_records == NULL)
+		return;
+
+	refs = hash_find_bin(same_decl_records, (const char *)&rec,
+			     sizeof(rec));
+	if (refs == NULL)
+		return;
+
+	for (i = 0; i < refs->pairs.count; i++)
+		same_decl_drop(&refs->pairs.keys[i]);
+	hash_del_bin(same_decl_records, (const char *)&rec, sizeof(rec));
+}
+
+/* The pair being compared uses the verdict of pair */
+static void same_decl_use(struct same_decl_cache *cache,
+			  struct same_decl_pair *pair)
+{
+	struct same_decl_pair *top = cache->top;
+
+	if (top == NULL)
+		return;
+
+	same_decl_keys_add(&pair->users, &top->key);
+	if (pair->state == SAME_DECL_GUESSED) {
+		top->state = SAME_DECL_GUESSED;
+	} else if (pair->state == SAME_DECL_ACTIVE) {
+		if (pair->depth < top->low)
+			top->low = pair->depth;
+	} else if (pair->state == SAME_DECL_PENDING) {
+		if (pair->low < top->low)
+			top->low = pair->low;
+	}
+}
+
+/* Settle the verdict of pair, which has just been compared */
+static void same_decl_settle(struct same_decl_cache *cache,
+			     struct same_decl_pair *pair,
+			     struct same_decl_pair *pending)
+{
+	struct same_decl_pair *p;
+
+	if (!pair->same) {
+		/* the comparison stops: only the pairs above are compared */
+		same_decl_keep(pair);
+		return;
+	}
+
+	if (pair->state == SAME_DECL_GUESSED) {
+		for (p = cache->pending; p != pending; p = p->pending)
+			p->state = SAME_DECL_GUESSED;
+		cache->pending = pending;
+		return;
+	}
+
+	if (pair->low < pair->depth) {
+		pair->state = SAME_DECL_PENDING;
+		pair->pending = cache->pending;
+		cache->pending = pair;
+		return;
+	}
+
+	/* the pairs assuming this one are the same too */
+	for (p = cache->pending; p != pending; p = p->pending)
+		same_decl_keep(p);
+	cache->pending = pending;
+	same_decl_keep(pair);
+}
+
 bool record_same_declarations(struct record *r1, struct record *r2,
-			      struct set *processed)
+			      struct same_decl_cache *cache)
 {
+	struct same_decl_key key = { .r1 = r1, .r2 = r2 };
+	struct same_decl_pair *pair, *top, *pending;
+
 	if (r1 == r2)
 		return true;
 
@@ -578,13 +809,67 @@ bool record_same_declarations(struct record *r1, struct record *r2,
 		/* since they are not same, only one is a declaration */
 		return false;
 
-	if (set_contains(processed, r1->key))
+	pair = hash_find(cache->processed, r1->key);
+	if (pair != NULL) {
 		/* skipping already processed record */
+		if (pair->key.r1 == r1 && pair->key.r2 == r2)
+			same_decl_use(cache, pair);
+		else if (cache->top != NULL)
+			cache->top->state = SAME_DECL_GUESSED;
 		return true;
+	}
+
+	pair = hash_find_bin(same_decl_pairs, (const char *)&key, sizeof(key));
+	if (pair != NULL) {
+		same_decl_use(cache, pair);
+		return pair->same;
+	}
+
+	pair = safe_zmalloc(sizeof(*pair));
+	pair->key = key;
+	pair->state = SAME_DECL_ACTIVE;
+	pair->depth = cache->depth;
+	pair->low = SAME_DECL_NONE;
+	pair->visited = cache->visited;
+	cache->visited = pair;
+	hash_add(cache->processed, r1->key, pair);
+
+	top = cache->top;
+	pending = cache->pending;
+	cache->top = pair;
+	cache->depth++;
+	pair->same = obj_same_declarations(r1->obj, r2->obj, cache);
+	cache->depth--;
+	cache->top = top;
+
+	same_decl_settle(cache, pair, pending);
+	same_decl_use(cache, pair);
+
+	return pair->same;
+}
+
+static bool record_same_declarations_cached(struct record *r1,
+					    struct record *r2)
+{
+	struct same_decl_cache cache = { .top = NULL };
+	struct same_decl_pair *pair, *next;
+	bool same;
+
+	same_decl_init();
+	cache.processed = hash_new(PROCESSED_SIZE, NULL);
+	if (cache.processed == NULL)
+		fail("Cannot create hash");
+
+	same = record_same_declarations(r1, r2, &cache);
 
-	set_add(processed, r1->key);
+	for (pair = cache.visited; pair != NULL; pair = next) {
+		next = pair->visited;
+		if (pair->state != SAME_DECL_KEPT)
+			same_decl_pair_free(pair);
+	}
+	hash_free(cache.processed);
 
-	return obj_same_declarations(r1->obj, r2->obj, processed);
+	return same;
 }
 
 static struct record *record_alloc(void)
@@ -624,6 +909,7 @@ static void record_free_weak(struct record *rec)
 
 static void record_free(struct record *rec)
 {
+	same_decl_forget(rec);
 	if (rec->free)
 		rec->free(rec);
 	free(rec);
@@ -642,7 +928,7 @@ static void record_get(struct record *rec)
 	rec->ref_count++;
 }
 
-static void record_dump_regular(struct record *rec, FILE *f);
+static void record_dump_regular(struct record *rec, struct buffer *b);
 
 static struct record *record_new_regular(const char *key)
 {
@@ -658,7 +944,7 @@ static struct record *record_new_regular(const char *key)
 	return rec;
 }
 
-static void record_dump_assembly(struct record *rec, FILE *f);
+static void record_dump_assembly(struct record *rec, struct buffer *b);
 
 static struct record *record_new_assembly(const char *key)
 {
@@ -681,7 +967,7 @@ static struct record *record_new_assembly(const char *key)
 	return rec;
 }
 
-static void record_dump_weak(struct record *rec, FILE *f);
+static void record_dump_weak(struct record *rec, struct buffer *b);
 
 static struct record *record_new_weak(const char *key, const char *link)
 {
@@ -704,27 +990,6 @@ static obj_t *record_obj(struct record *rec)
 	return rec->obj;
 }
 
-static struct record *record_copy(struct record *src)
-{
-	struct record *res = record_new_regular("");
-	obj_t *o1 = record_obj(src);
-
-	res->obj = obj_merge(o1, o1, MERGE_FLAG_DECL_MERGE);
-	obj_fill_parent(res->obj);
-	res->origin = src->origin;
-
-	return res;
-}
-
-static obj_t *record_obj_exchange(struct record *rec, obj_t *o)
-{
-	obj_t *old;
-
-	old = rec->obj;
-	rec->obj = o;
-	return old;
-}
-
 static const char *record_origin(struct record *rec)
 {
 	return rec->origin;
@@ -824,98 +1089,293 @@ static void record_set_version(struct record *rec, int version)
 static void record_close(struct record *rec, obj_t *obj)
 {
 	obj_fill_parent(obj);
-	rec->obj = obj;
+	rec->obj = obj_hashcons(obj);
 }
 
-static void record_stack_dump_and_clear(struct record *rec, FILE *f)
+static void record_stack_dump_and_clear(struct record *rec, struct buffer *b)
 {
 	char *data = stack_pop(rec->stack);
 
 	if (data == NULL)
 		return;
 
-	fprintf(f, "Stack:\n");
+	buffer_puts(b, "Stack:\n");
 	do {
-		fprintf(f, "-> \"%s\"\n", data);
+		buffer_put(b, "-> \"", 4);
+		buffer_puts(b, data);
+		buffer_put(b, "\"\n", 2);
 		free(data);
 	} while ((data = stack_pop(rec->stack)) != NULL);
 }
 
-static void record_dump_regular(struct record *rec, FILE *f)
+static void record_dump_regular(struct record *rec, struct buffer *b)
 {
-	int rc;
-
-	fprintf(f, FILEFMT_VERSION_STRING);
-	if (rec->cu != NULL) {
-		rc = fputs(rec->cu, f);
-		if (rc == EOF)
-			fail("Could not put CU name");
-	}
-	rc = fputs(rec->origin, f);
-	if (rc == EOF)
-		fail("Could not put origin");
+	buffer_puts(b, FILEFMT_VERSION_STRING);
+	if (rec->cu != NULL)
+		buffer_puts(b, rec->cu);
+	buffer_puts(b, rec->origin);
 
-	record_stack_dump_and_clear(rec, f);
+	record_stack_dump_and_clear(rec, b);
 
-	fprintf(f, "Symbol:\n");
-	if (rec->obj->byte_size != 0)
-		fprintf(f, "Byte size %u\n", rec->obj->byte_size);
-	if (rec->obj->alignment != 0)
-		fprintf(f, "Alignment %u\n", rec->obj->alignment);
+	buffer_puts(b, "Symbol:\n");
+	if (rec->obj->byte_size != 0) {
+		buffer_puts(b, "Byte size ");
+		buffer_put_uint(b, rec->obj->byte_size);
+		buffer_putc(b, '\n');
+	}
+	if (rec->obj->alignment != 0) {
+		buffer_puts(b, "Alignment ");
+		buffer_put_uint(b, rec->obj->alignment);
+		buffer_putc(b, '\n');
+	}
 
-	obj_dump(rec->obj, f);
+	obj_dump(rec->obj, b);
 }
 
-static void record_dump_assembly(struct record *rec, FILE *f)
+static void record_dump_assembly(struct record *rec, struct buffer *b)
 {
 	char *name = filenametosymbol(rec->key);
-	int rc;
 
-	rc = fprintf(f, FILEFMT_VERSION_STRING "Symbol:\nassembly %s\n", name);
+	buffer_puts(b, FILEFMT_VERSION_STRING "Symbol:\nassembly ");
+	buffer_puts(b, name);
+	buffer_putc(b, '\n');
 	free(name);
-	if (rc < 0)
-		fail("Could not put assembly\n");
 }
 
-static void record_dump_weak(struct record *rec, FILE *f)
+static void record_dump_weak(struct record *rec, struct buffer *b)
 {
 	char *name = filenametosymbol(rec->key);
-	int rc;
 
-	rc = fprintf(f, FILEFMT_VERSION_STRING "Symbol:\nweak %s -> %s\n",
-		     name, rec->link);
+	buffer_puts(b, FILEFMT_VERSION_STRING "Symbol:\nweak ");
+	buffer_puts(b, name);
+	buffer_puts(b, " -> ");
+	buffer_puts(b, rec->link);
+	buffer_putc(b, '\n');
 	free(name);
-	if (rc < 0)
-		fail("Could not put weak link\n");
 }
 
-static void record_dump(struct record *rec, const char *dir)
+/*
+ * Dumping the records
+ *
+ * The directories of the records are created and opened only once, the
+ * record files are then created relative to the directory fds. The records
+ * are serialized and written by a pool of threads, each of them owning its
+ * own buffer. The hashes of the files are then written in the manifest,
+ * along with their checksums and the reverse references between them.
+ */
+#define DUMP_THREADS_MIN 4
+#define DUMP_THREADS_MAX 16
+
+struct dump_dir {
+	int fd;
+	char path[];
+};
+
+struct dump_item {
+	struct record *rec;
+	int dirfd;
+	char *path;		/* full path, for error messages */
+	const char *name;	/* file name relative to dirfd */
+	const char *file;	/* file name relative to the output */
+	uint64_t hash;		/* content hash, for the manifest */
+	uint64_t content;	/* see checksum_record() */
+	uint64_t checksum;	/* see record_db_checksums() */
+	size_t size;
+};
+
+struct dump_ctx {
+	struct dump_item *items;
+	size_t count;
+	size_t next;		/* next item to dump, taken atomically */
+	bool partial;		/* some records are left out, see below */
+	pthread_mutex_t lock;
+	const char *error;	/* first failure of the writers */
+};
+
+/* A writer of the pool, see record_dump_worker() */
+struct dump_worker {
+	struct dump_ctx *ctx;
+	struct buffer buf;
+	pthread_t thread;
+};
+
+static void dump_dir_free(void *value)
+{
+	struct dump_dir *dir = value;
+
+	if (close(dir->fd) < 0)
+		fail("Cannot close directory '%s': %s", dir->path,
+		     strerror(errno));
+	free(dir);
+}
+
+static int dump_dir_get(struct hash *dirs, const char *path)
+{
+	struct dump_dir *dir;
+	size_t len;
+
+	dir = hash_find(dirs, path);
+	if (dir != NULL)
+		return dir->fd;
+
+	len = strlen(path);
+	dir = safe_zmalloc(sizeof(*dir) + len + 1);
+	memcpy(dir->path, path, len + 1);
+
+	rec_mkdir(dir->path);
+	dir->fd = open(dir->path, O_RDONLY | O_DIRECTORY);
+	if (dir->fd < 0)
+		fail("Cannot open directory '%s': %s", dir->path,
+		     strerror(errno));
+
+	if (hash_add(dirs, dir->path, dir) < 0)
+		fail("Cannot add directory '%s' to the hash", dir->path);
+
+	return dir->fd;
+}
+
+/* Name of the record file, relative to the output directory */
+static char *record_file_name(struct record *rec)
 {
-	char path[PATH_MAX];
-	FILE *f;
+	char *name;
+
+	if (rec->version == 0)
+		safe_asprintf(&name, "%s.txt", rec->key);
+	else
+		safe_asprintf(&name, "%s-%i.txt", rec->key, rec->version);
+
+	return name;
+}
+
+static void dump_item_init(struct dump_item *item, const char *dir,
+			   struct hash *dirs)
+{
+	char *name = record_file_name(item->rec);
 	char *slash;
 
-	if (rec->version == 0) {
-		snprintf(path, sizeof(path),
-			 "%s/%s.txt", dir, rec->key);
-	} else {
-		snprintf(path, sizeof(path),
-			 "%s/%s-%i.txt", dir, rec->key, rec->version);
-	}
+	safe_asprintf(&item->path, "%s/%s", dir, name);
+	item->file = item->path + strlen(item->path) - strlen(name);
+	free(name);
 
-	slash = strrchr(path, '/');
+	slash = strrchr(item->path, '/');
 	assert(slash != NULL);
 	*slash = '\0';
-	rec_mkdir(path);
+	item->dirfd = dump_dir_get(dirs, item->path);
 	*slash = '/';
+	item->name = slash + 1;
+}
+
+/*
+ * Write the record to its file
+ *
+ * The file is serialized in the buffer b first, then written at once.
+ */
+/*
+ * Record a failure of a writer, only the first one is kept. The writers
+ * stop at the next record.
+ */
+static bool dump_error(struct dump_ctx *ctx, const char *fmt, ...)
+{
+	va_list args;
+	char *msg;
+
+	va_start(args, fmt);
+	if (vasprintf(&msg, fmt, args) < 0)
+		msg = NULL;
+	va_end(args);
+
+	/* a failure must not get lost, even for lack of memory */
+	if (msg == NULL)
+		msg = "Cannot write the records\n";
+
+	pthread_mutex_lock(&ctx->lock);
+	if (ctx->error == NULL)
+		ctx->error = msg;
+	__atomic_store_n(&ctx->next, ctx->count, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&ctx->lock);
+
+	return false;
+}
+
+static bool record_dump(struct dump_ctx *ctx, struct dump_item *item,
+			struct buffer *b)
+{
+	struct record *rec = item->rec;
+	int fd;
+
+	buffer_reset(b);
+	rec->dump(rec, b);
+	item->hash = manifest_hash(b->data, b->len);
+	item->size = b->len;
+
+	fd = openat(item->dirfd, item->name,
+		    O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+		return dump_error(ctx, "Cannot create record file '%s': %s\n",
+				  item->path, strerror(errno));
+
+	if (buffer_write(b, fd) < 0) {
+		dump_error(ctx, "Cannot write record file '%s': %s\n",
+			   item->path, strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	if (close(fd) < 0)
+		return dump_error(ctx, "Cannot close record file '%s': %s\n",
+				  item->path, strerror(errno));
+
+	return true;
+}
+
+/*
+ * Dump the records until there are none left or a writer failed. The
+ * failures, including those of fail(), are left to the calling thread to
+ * report: exiting or jumping from a writer would leave the others behind.
+ */
+static void *record_dump_worker(void *arg)
+{
+	struct dump_worker *w = arg;
+	struct dump_ctx *ctx = w->ctx;
+	jmp_buf *saved = fail_jmp;
+	jmp_buf env;
+	size_t i;
+
+	if (setjmp(env) != 0) {
+		dump_error(ctx, "%s", fail_message());
+		goto out;
+	}
+	fail_jmp = &env;
 
-	f = fopen(path, "w");
-	if (f == NULL)
-		fail("Cannot create record file '%s': %m", path);
+	while ((i = __atomic_fetch_add(&ctx->next, 1, __ATOMIC_RELAXED)) <
+	       ctx->count) {
+		if (!record_dump(ctx, &ctx->items[i], &w->buf))
+			break;
+	}
+out:
+	fail_jmp = saved;
 
-	rec->dump(rec, f);
+	return NULL;
+}
 
-	fclose(f);
+/*
+ * The writers mostly wait for the file system (think NFS), so use more of
+ * them than there are CPUs.
+ */
+static unsigned int record_dump_nthreads(size_t count)
+{
+	long n = 2 * sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n < DUMP_THREADS_MIN)
+		n = DUMP_THREADS_MIN;
+	if (n > DUMP_THREADS_MAX)
+		n = DUMP_THREADS_MAX;
+	if ((size_t)n > count)
+		n = count;
+	if (n < 1)
+		n = 1;
+
+	return n;
 }
 
 static void list_record_free(void *value)
@@ -926,17 +1386,14 @@ static void list_record_free(void *value)
 }
 
 /*
- * merge rec_src to the record rec_dst
+ * Check if rec_src can be merged to the record rec_dst
  */
-static bool record_merge(struct record *rec_dst,
-			 struct record *rec_src,
-			 unsigned int flags)
+static bool record_can_merge(struct record *rec_dst,
+			     struct record *rec_src,
+			     unsigned int flags)
 {
 	const char *s1;
 	const char *s2;
-	obj_t *o1;
-	obj_t *o2;
-	obj_t *o;
 
 	s1 = record_origin(rec_dst);
 	s2 = record_origin(rec_src);
@@ -944,16 +1401,25 @@ static bool record_merge(struct record *rec_dst,
 	if (s1 != s2)
 		return false;
 
-	o1 = record_obj(rec_dst);
-	o2 = record_obj(rec_src);
+	return obj_can_merge(record_obj(rec_dst), record_obj(rec_src), flags);
+}
 
-	o = obj_merge(o1, o2, flags);
-	if (o == NULL)
+/*
+ * merge rec_src to the record rec_dst
+ *
+ * The object of rec_dst is modified in place, so nothing is touched
+ * unless the whole merge is possible.
+ */
+static bool record_merge(struct record *rec_dst,
+			 struct record *rec_src,
+			 unsigned int flags)
+{
+	if (!record_can_merge(rec_dst, rec_src, flags))
 		return false;
 
-	obj_fill_parent(o);
-	o = record_obj_exchange(rec_dst, o);
-	obj_free(o);
+	obj_merge_in_place(record_obj(rec_dst), record_obj(rec_src));
+	same_decl_forget(rec_dst);
+	same_decl_forget(rec_src);
 
 	return true;
 }
@@ -1044,13 +1510,15 @@ struct merging_ctx {
 	/*
 	 * records found since manual reset;
 	 * newly found records are merged with records in the hash
+	 * (with check_only, the hash holds the list of the records found
+	 * for each key instead)
 	 */
 	struct hash *accumulated_records;
 
 
 	unsigned int flags;
 
-	bool use_copies; /* use copies of records instead of actual record */
+	bool check_only; /* only check that the records can be merged */
 	bool merged;
 };
 
@@ -1064,6 +1532,47 @@ static int record_merge_walk_object(obj_t *obj, void *arg)
 	return record_merge_walk_record(obj->ref_record, arg);
 }
 
+/*
+ * Check that followed could be merged with the records found so far
+ * for its key, without merging anything.
+ *
+ * The merged record would only differ from the records of the group by
+ * the declarations replaced by their definition. Checking followed
+ * against each record of the group is thus the same as checking it
+ * against the merged record.
+ */
+static int record_merge_check_record(struct record *followed,
+				     struct merging_ctx *ctx)
+{
+	struct list *group;
+	struct list_node *iter;
+
+	group = hash_find(ctx->accumulated_records, followed->key);
+
+	if (group == NULL) {
+		/* first of this key found */
+		group = list_new(NULL);
+		hash_add(ctx->accumulated_records, followed->key, group);
+	} else {
+		LIST_FOR_EACH(group, iter) {
+			if (list_node_data(iter) == followed)
+				return CB_SKIP;
+		}
+
+		LIST_FOR_EACH(group, iter) {
+			if (!record_can_merge(list_node_data(iter), followed,
+					      ctx->flags))
+				return CB_FAIL;
+		}
+
+		ctx->merged = true;
+	}
+
+	list_add(group, followed);
+
+	return CB_CONT;
+}
+
 static int record_merge_walk_record(struct record *followed,
 				    struct merging_ctx *ctx)
 {
@@ -1077,14 +1586,23 @@ static int record_merge_walk_record(struct record *followed,
 		return CB_CONT;
 	set_add(ctx->current_records, followed->key);
 
+	if (ctx->check_only) {
+		switch (record_merge_check_record(followed, ctx)) {
+		case CB_FAIL:
+			return CB_FAIL;
+		case CB_SKIP:
+			return CB_CONT;
+		}
+
+		return obj_walk_tree(followed->obj,
+				     record_merge_walk_object, ctx);
+	}
+
 	record_dst = hash_find(ctx->accumulated_records, followed->key);
 
 	if (record_dst == NULL) {
 		/* first of this key found */
-		if (ctx->use_copies)
-			record_dst = record_copy(followed);
-		else
-			record_dst = followed;
+		record_dst = followed;
 		hash_add(ctx->accumulated_records, followed->key, record_dst);
 	} else {
 		if (record_dst == followed)
@@ -1094,14 +1612,11 @@ static int record_merge_walk_record(struct record *followed,
 			return CB_FAIL;
 
 		ctx->merged = true;
-		if (!ctx->use_copies) {
-			record_redirect_dependents(record_dst, followed);
-			list_concat(&record_dst->dependents,
-				    &followed->dependents);
+		record_redirect_dependents(record_dst, followed);
+		list_concat(&record_dst->dependents, &followed->dependents);
 
-			record_list_node_make_unavailable(followed->list_node);
-			clean_up = true;
-		}
+		record_list_node_make_unavailable(followed->list_node);
+		clean_up = true;
 	}
 
 	int status = obj_walk_tree(followed->obj,
@@ -1126,15 +1641,15 @@ static int record_merge_walk(struct record *starting_rec,
 }
 
 static bool record_merge_many_sub(struct list *list,
-				  unsigned int flags, bool use_copies)
+				  unsigned int flags, bool check_only)
 {
 	void (*free_fun)(void *);
 	struct merging_ctx ctx;
 	struct list_node *iter;
 	bool result = false;
 
-	if (use_copies)
-		free_fun = (void (*)(void *))record_free;
+	if (check_only)
+		free_fun = (void (*)(void *))list_free;
 	else
 		free_fun = NULL;
 
@@ -1142,14 +1657,13 @@ static bool record_merge_many_sub(struct list *list,
 	ctx.current_records = NULL;
 	ctx.merged = false;
 
-	/* first, check if the list can be merged into one record */
-	ctx.use_copies = use_copies;
+	ctx.check_only = check_only;
 	ctx.accumulated_records = hash_new(PROCESSED_SIZE, free_fun);
 
 	LIST_FOR_EACH(list, iter) {
 		result = record_merge_walk(list_node_data(iter), &ctx);
 
-		if (result == false && use_copies)
+		if (result == false && check_only)
 			break;
 	}
 	hash_free(ctx.accumulated_records);
@@ -1200,15 +1714,12 @@ static bool record_merge_pair(struct record *record_dst,
 			      struct record *record_src)
 {
 	bool merged;
-	struct set *processed;
 	struct list to_merge;
 
 	if (record_dst == NULL)
 		return false;
 
-	processed = set_init(PROCESSED_SIZE);
-	merged = record_same_declarations(record_dst, record_src, processed);
-	set_free(processed);
+	merged = record_same_declarations_cached(record_dst, record_src);
 	if (!merged) {
 		record_dst->failed++;
 		return false;
@@ -1380,13 +1891,547 @@ static struct record_db *record_db_init(void)
 	return (struct record_db *)db;
 }
 
-static void record_db_dump(struct record_db *_db, char *dir)
+/*
+ * Checksums of the records
+ *
+ * The checksum of a record covers its own type (see checksum_record()) and
+ * the checksums of all the records it references, so it changes whenever
+ * anything reachable from the record changes. The records referencing each
+ * other (a strongly connected component of the reference graph) share a
+ * component hash covering all of them, the references to declarations are
+ * leaves.
+ *
+ * The components are found by Tarjan's algorithm, which completes them in
+ * reverse topological order: the checksums of the referenced components
+ * are always known when a component is completed.
+ */
+#define CHECKSUM_UNSET UINT_MAX
+
+/* References between the dumped records */
+struct record_graph {
+	struct dump_item *items;
+	size_t count;
+	struct hash *index;	/* record -> item */
+	unsigned int *edges;	/* references */
+	unsigned int *first;	/* of i in edges[first[i]..first[i+1]] */
+	unsigned int nedges;
+	unsigned int size;
+};
+
+struct checksum_frame {
+	unsigned int item;
+	unsigned int next;	/* next edge to visit */
+};
+
+static int uint_cmp(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *)a;
+	unsigned int y = *(const unsigned int *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static uint64_t checksum_u64(uint64_t h, uint64_t v)
+{
+	char bytes[8];
+	unsigned int i;
+
+	/* fixed byte order, the checksums don't depend on the host */
+	for (i = 0; i < 8; i++)
+		bytes[i] = v >> (8 * i);
+
+	return manifest_hash_update(h, bytes, sizeof(bytes));
+}
+
+static uint64_t checksum_str(uint64_t h, const char *s)
+{
+	if (s == NULL)
+		return manifest_hash_update(h, "", 1);
+
+	/* the terminator separates the strings */
+	h = manifest_hash_update(h, "s", 1);
+	return manifest_hash_update(h, s, strlen(s) + 1);
+}
+
+/* The name of the referenced type, without its header or its version */
+static const char *checksum_ref_name(obj_t *o)
+{
+	const char *key = record_get_key(o->ref_record);
+	const char *slash = strrchr(key, '/');
+
+	return slash != NULL ? slash + 1 : key;
+}
+
+/*
+ * Hash of what compare judges in the object tree. The referenced records
+ * are only named: their content comes in through the edges of the graph.
+ */
+static uint64_t checksum_obj(uint64_t h, obj_t *o)
+{
+	unsigned long value = 0;
+	unsigned int i, len;
+
+	if (o == NULL)
+		return checksum_u64(h, 0);
+
+	if (has_constant(o))
+		value = o->constant;
+	else if (has_index(o))
+		value = o->index;
+	else if (has_offset(o))
+		value = o->offset;
+	len = obj_list_len(o->member_list);
+
+	h = checksum_u64(h, o->type + 1);
+	h = checksum_u64(h, o->is_bitfield);
+	h = checksum_u64(h, o->first_bit);
+	h = checksum_u64(h, o->last_bit);
+	h = checksum_u64(h, o->alignment);
+	h = checksum_u64(h, o->byte_size);
+	h = checksum_u64(h, value);
+	h = checksum_u64(h, len);
+
+	if (o->type == __type_reffile) {
+		h = checksum_str(h, checksum_ref_name(o));
+	} else {
+		h = checksum_str(h, o->name);
+		h = checksum_str(h, o->base_type);
+		if (is_weak(o))
+			h = checksum_str(h, o->link);
+	}
+
+	h = checksum_obj(h, o->ptr);
+	for (i = 0; i < len; i++)
+		h = checksum_obj(h, o->member_list->member[i]);
+
+	return h;
+}
+
+/*
+ * Hash of the content of the record, leaving out where it was found: the
+ * file, line, compilation unit and stack of the declaration.
+ */
+static uint64_t checksum_record(struct record *rec)
+{
+	uint64_t h = MANIFEST_HASH_INIT;
+	char *name;
+
+	if (rec->dump == record_dump_regular)
+		return checksum_obj(h, rec->obj);
+
+	name = filenametosymbol(rec->key);
+	h = checksum_str(h, rec->dump == record_dump_weak ? "weak" :
+			 "assembly");
+	h = checksum_str(h, name);
+	h = checksum_str(h, rec->link);
+	free(name);
+
+	return h;
+}
+
+static int record_graph_add_edge(obj_t *o, void *args)
+{
+	struct record_graph *ctx = args;
+	struct dump_item *ref;
+
+	if (o->type != __type_reffile || o->ref_record == NULL)
+		return CB_CONT;
+
+	/* declarations are not dumped */
+	ref = hash_find_bin(ctx->index, (const char *)&o->ref_record,
+			    sizeof(o->ref_record));
+	if (ref == NULL)
+		return CB_CONT;
+
+	if (ctx->nedges == ctx->size) {
+		ctx->size = ctx->size ? ctx->size * 2 : 1024;
+		ctx->edges = safe_realloc(ctx->edges,
+					  ctx->size * sizeof(*ctx->edges));
+	}
+	ctx->edges[ctx->nedges++] = ref - ctx->items;
+
+	return CB_CONT;
+}
+
+static void record_graph_init(struct record_graph *g,
+			      struct dump_item *items, size_t count)
+{
+	size_t i;
+
+	memset(g, 0, sizeof(*g));
+	g->items = items;
+	g->count = count;
+
+	g->index = hash_new(DB_SIZE, NULL);
+	if (g->index == NULL)
+		fail("Cannot create the record index\n");
+	for (i = 0; i < count; i++)
+		hash_add_bin(g->index, (const char *)&items[i].rec,
+			     sizeof(items[i].rec), &items[i]);
+
+	g->first = safe_zmalloc((count + 1) * sizeof(*g->first));
+	for (i = 0; i < count; i++) {
+		items[i].content = checksum_record(items[i].rec);
+		g->first[i] = g->nedges;
+		if (items[i].rec->obj != NULL)
+			obj_walk_tree(items[i].rec->obj,
+				      record_graph_add_edge, g);
+	}
+	g->first[count] = g->nedges;
+}
+
+static void record_graph_free(struct record_graph *g)
+{
+	free(g->first);
+	free(g->edges);
+	hash_free(g->index);
+}
+
+static void checksum_component(struct record_graph *ctx,
+			       unsigned int *members, unsigned int count,
+			       unsigned int *comp, unsigned int id)
+{
+	uint64_t h = MANIFEST_HASH_INIT;
+	unsigned int i, e;
+
+	/* the members are sorted, so the hash does not depend on the walk */
+	qsort(members, count, sizeof(*members), uint_cmp);
+
+	for (i = 0; i < count; i++)
+		h = checksum_u64(h, ctx->items[members[i]].content);
+	for (i = 0; i < count; i++) {
+		unsigned int m = members[i];
+
+		for (e = ctx->first[m]; e < ctx->first[m + 1]; e++) {
+			unsigned int w = ctx->edges[e];
+
+			if (comp[w] != id)
+				h = checksum_u64(h, ctx->items[w].checksum);
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		struct dump_item *item = &ctx->items[members[i]];
+
+		item->checksum = checksum_u64(h, item->content);
+	}
+}
+
+static void record_db_checksums(struct record_graph *g)
+{
+	struct checksum_frame *frames;
+	unsigned int *index, *low, *comp, *stack;
+	unsigned int next_index = 0, ncomp = 0, sp = 0;
+	size_t count = g->count;
+	size_t i;
+
+	index = safe_zmalloc(count * sizeof(*index));
+	low = safe_zmalloc(count * sizeof(*low));
+	comp = safe_zmalloc(count * sizeof(*comp));
+	stack = safe_zmalloc(count * sizeof(*stack));
+	frames = safe_zmalloc(count * sizeof(*frames));
+	for (i = 0; i < count; i++)
+		index[i] = comp[i] = CHECKSUM_UNSET;
+
+	for (i = 0; i < count; i++) {
+		unsigned int depth = 0;
+
+		if (index[i] != CHECKSUM_UNSET)
+			continue;
+
+		frames[depth++] = (struct checksum_frame){ i, g->first[i] };
+		index[i] = low[i] = next_index++;
+		stack[sp++] = i;
+
+		while (depth > 0) {
+			struct checksum_frame *f = &frames[depth - 1];
+			unsigned int v = f->item;
+			unsigned int base;
+
+			if (f->next < g->first[v + 1]) {
+				unsigned int w = g->edges[f->next++];
+
+				if (index[w] == CHECKSUM_UNSET) {
+					index[w] = low[w] = next_index++;
+					stack[sp++] = w;
+					frames[depth].item = w;
+					frames[depth++].next = g->first[w];
+				} else if (comp[w] == CHECKSUM_UNSET &&
+					   index[w] < low[v]) {
+					/* w is on the stack */
+					low[v] = index[w];
+				}
+				continue;
+			}
+
+			depth--;
+			if (depth > 0 && low[v] < low[frames[depth - 1].item])
+				low[frames[depth - 1].item] = low[v];
+
+			if (low[v] != index[v])
+				continue;
+
+			/* v is the root of a component, pop its members */
+			base = sp;
+			do {
+				comp[stack[--base]] = ncomp;
+			} while (stack[base] != v);
+			checksum_component(g, stack + base, sp - base,
+					   comp, ncomp);
+			ncomp++;
+			sp = base;
+		}
+	}
+
+	free(frames);
+	free(stack);
+	free(comp);
+	free(low);
+	free(index);
+}
+
+static int dump_item_cmp(const void *i1, const void *i2)
+{
+	return archive_name_cmp(((struct dump_item *)i1)->file,
+				((struct dump_item *)i2)->file);
+}
+
+/*
+ * Serialize the reverse references of the records: for each record
+ * referenced by others, a line with its file followed by the files of the
+ * records referencing it.
+ */
+static void record_db_dependents(struct record_graph *g, struct buffer *b)
+{
+	unsigned int *first, *deps, *last, *pos;
+	size_t count = g->count;
+	unsigned int v, e, w;
+
+	first = safe_zmalloc((count + 1) * sizeof(*first));
+	last = safe_zmalloc(count * sizeof(*last));
+	pos = safe_zmalloc(count * sizeof(*pos));
+	deps = safe_zmalloc((g->nedges + 1) * sizeof(*deps));
+
+	/* count the dependents, without duplicates or self references */
+	for (v = 0; v < count; v++) {
+		for (e = g->first[v]; e < g->first[v + 1]; e++) {
+			w = g->edges[e];
+			if (w != v && last[w] != v + 1) {
+				last[w] = v + 1;
+				first[w + 1]++;
+			}
+		}
+	}
+	for (w = 0; w < count; w++) {
+		first[w + 1] += first[w];
+		pos[w] = first[w];
+		last[w] = 0;
+	}
+
+	/* the dependents are sorted, as the records are */
+	for (v = 0; v < count; v++) {
+		for (e = g->first[v]; e < g->first[v + 1]; e++) {
+			w = g->edges[e];
+			if (w != v && last[w] != v + 1) {
+				last[w] = v + 1;
+				deps[pos[w]++] = v;
+			}
+		}
+	}
+
+	for (w = 0; w < count; w++) {
+		if (first[w] == first[w + 1])
+			continue;
+
+		buffer_puts(b, g->items[w].file);
+		for (e = first[w]; e < first[w + 1]; e++) {
+			buffer_putc(b, ' ');
+			buffer_puts(b, g->items[deps[e]].file);
+		}
+		buffer_putc(b, '\n');
+	}
+
+	free(deps);
+	free(pos);
+	free(last);
+	free(first);
+}
+
+/* Files written next to the records, see manifest.h */
+struct dump_index {
+	struct buffer manifest;
+	struct buffer checksums;
+	struct buffer dependents;
+};
+
+static void dump_index_init(struct dump_index *idx, struct dump_ctx *ctx)
+{
+	struct record_graph graph;
+	size_t i;
+
+	qsort(ctx->items, ctx->count, sizeof(*ctx->items), dump_item_cmp);
+	record_graph_init(&graph, ctx->items, ctx->count);
+	record_db_checksums(&graph);
+
+	buffer_init(&idx->manifest);
+	buffer_init(&idx->checksums);
+	buffer_init(&idx->dependents);
+	for (i = 0; i < ctx->count; i++) {
+		struct dump_item *item = &ctx->items[i];
+		char *symbol;
+
+		manifest_put(&idx->manifest, item->file, item->hash,
+			     item->checksum, item->size);
+
+		if (!is_symbol_file(item->rec->key))
+			continue;
+
+		symbol = filenametosymbol(item->rec->key);
+		manifest_put_checksum(&idx->checksums, symbol,
+				      item->checksum);
+		free(symbol);
+	}
+	record_db_dependents(&graph, &idx->dependents);
+
+	record_graph_free(&graph);
+}
+
+static void dump_index_free(struct dump_index *idx)
+{
+	buffer_free(&idx->manifest);
+	buffer_free(&idx->checksums);
+	buffer_free(&idx->dependents);
+}
+
+static void dump_write_file(const char *dir, const char *name,
+			    struct buffer *b)
+{
+	char *path;
+	int fd;
+
+	safe_asprintf(&path, "%s/%s", dir, name);
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+		fail("Cannot create '%s': %s", path, strerror(errno));
+	if (buffer_write(b, fd) < 0)
+		fail("Cannot write '%s': %s", path, strerror(errno));
+	if (close(fd) < 0)
+		fail("Cannot close '%s': %s", path, strerror(errno));
+	free(path);
+}
+
+static void record_db_dump_files(struct dump_ctx *ctx, const char *dir)
+{
+	struct hash *dirs;
+	struct dump_worker workers[DUMP_THREADS_MAX];
+	unsigned int nthreads, started, t;
+	struct dump_index idx;
+	size_t i;
+
+	/* create the directory skeleton */
+	dirs = hash_new(64, dump_dir_free);
+	if (dirs == NULL)
+		fail("Cannot create the directory hash\n");
+	for (i = 0; i < ctx->count; i++)
+		dump_item_init(&ctx->items[i], dir, dirs);
+
+	/* the calling thread is one of the writers, the last one */
+	nthreads = record_dump_nthreads(ctx->count);
+	pthread_mutex_init(&ctx->lock, NULL);
+	for (t = 0; t < nthreads; t++) {
+		workers[t].ctx = ctx;
+		buffer_init(&workers[t].buf);
+	}
+	for (started = 0; started + 1 < nthreads; started++) {
+		if (pthread_create(&workers[started].thread, NULL,
+				   record_dump_worker, &workers[started]) != 0)
+			break;
+	}
+	record_dump_worker(&workers[nthreads - 1]);
+	for (t = 0; t < started; t++)
+		pthread_join(workers[t].thread, NULL);
+	for (t = 0; t < nthreads; t++)
+		buffer_free(&workers[t].buf);
+	pthread_mutex_destroy(&ctx->lock);
+
+	hash_free(dirs);
+
+	/* the message is not freed, fail() does not return */
+	if (ctx->error != NULL)
+		fail("%s", ctx->error);
+
+	if (ctx->partial)
+		return;
+
+	dump_index_init(&idx, ctx);
+	dump_write_file(dir, MANIFEST_FILE, &idx.manifest);
+	dump_write_file(dir, CHECKSUMS_FILE, &idx.checksums);
+	dump_write_file(dir, DEPENDENTS_FILE, &idx.dependents);
+	dump_index_free(&idx);
+}
+
+/*
+ * Stream the records into the archive at path
+ *
+ * The members are sorted, so that the archive does not depend on the
+ * order of the records in the database.
+ */
+static void record_db_dump_archive(struct dump_ctx *ctx, const char *path)
+{
+	struct archive_writer *w;
+	struct dump_index idx;
+	struct buffer buf;
+	size_t i;
+
+	for (i = 0; i < ctx->count; i++) {
+		ctx->items[i].path = record_file_name(ctx->items[i].rec);
+		ctx->items[i].file = ctx->items[i].path;
+	}
+	qsort(ctx->items, ctx->count, sizeof(*ctx->items), dump_item_cmp);
+
+	w = archive_writer_open(path);
+	buffer_init(&buf);
+	for (i = 0; i < ctx->count; i++) {
+		struct record *rec = ctx->items[i].rec;
+
+		buffer_reset(&buf);
+		rec->dump(rec, &buf);
+		ctx->items[i].hash = manifest_hash(buf.data, buf.len);
+		ctx->items[i].size = buf.len;
+		archive_writer_add(w, ctx->items[i].path, buf.data, buf.len);
+	}
+	buffer_free(&buf);
+
+	if (ctx->partial) {
+		archive_writer_close(w);
+		return;
+	}
+
+	dump_index_init(&idx, ctx);
+	archive_writer_add(w, CHECKSUMS_FILE,
+			   idx.checksums.data, idx.checksums.len);
+	archive_writer_add(w, DEPENDENTS_FILE,
+			   idx.dependents.data, idx.dependents.len);
+	archive_writer_add(w, MANIFEST_FILE,
+			   idx.manifest.data, idx.manifest.len);
+	dump_index_free(&idx);
+	archive_writer_close(w);
+}
+
+/*
+ * Dump the records whose file is in the set only, or all of them if it is
+ * NULL. A partial dump has no manifest: the checksums cover the referenced
+ * records, which may be left out.
+ */
+void record_db_dump_only(struct record_db *_db, char *dir, struct hash *only)
 {
 	struct hash_iter iter;
 	const void *v;
 	struct hash *db = (struct hash *)_db;
+	struct dump_ctx ctx = { 0 };
+	size_t size = 0, i;
 
-	/* set correct versions */
+	/* set correct versions and collect the records */
 	hash_iter_init(db, &iter);
 	while (hash_iter_next(&iter, NULL, &v)) {
 		struct list_node *iter;
@@ -1397,26 +2442,128 @@ static void record_db_dump(struct record_db *_db, char *dir)
 			struct record *record = list_node_data(iter);
 
 			record_set_version(record, ver++);
+
+			if (only != NULL) {
+				char *name = record_file_name(record);
+				bool found = hash_find(only, name) != NULL;
+
+				free(name);
+				if (!found) {
+					ctx.partial = true;
+					continue;
+				}
+			}
+
+			if (ctx.count == size) {
+				size = size ? size * 2 : 1024;
+				ctx.items = safe_realloc(ctx.items,
+						size * sizeof(*ctx.items));
+			}
+			ctx.items[ctx.count++].rec = record;
 		}
 	}
 
+	if (is_archive(dir))
+		record_db_dump_archive(&ctx, dir);
+	else
+		record_db_dump_files(&ctx, dir);
+
+	for (i = 0; i < ctx.count; i++)
+		free(ctx.items[i].path);
+	free(ctx.items);
+}
+
+void record_db_dump(struct record_db *db, char *dir)
+{
+	record_db_dump_only(db, dir, NULL);
+}
+
+static int record_tree_name_refs(obj_t *o, void *args)
+{
+	if (o->type == __type_reffile && o->ref_record != NULL &&
+	    o->base_type == NULL)
+		o->base_type =
+			global_string_get_move(record_file_name(o->ref_record));
+
+	return CB_CONT;
+}
+
+/* Only the trees of the weak and assembly records belong to the index */
+static void record_tree_free(void *value)
+{
+	obj_t *o = value;
+
+	if (is_weak(o) || o->type == __type_assembly)
+		obj_free(o);
+}
+
+/*
+ * Index the trees of the records by the names of their files, as compare
+ * finds them in a dump: the references get the names of the files they
+ * point to. The weak and assembly records have no tree, they get one.
+ */
+struct hash *record_db_trees(struct record_db *_db)
+{
+	struct hash *db = (struct hash *)_db;
+	struct hash *trees;
+	struct hash_iter iter;
+	const void *v;
+
+	trees = hash_new(DB_SIZE, record_tree_free);
+	if (trees == NULL)
+		fail("Cannot create the record trees hash\n");
+
+	/* the versions first, they are part of the names */
 	hash_iter_init(db, &iter);
 	while (hash_iter_next(&iter, NULL, &v)) {
-		struct record_list *rec_list = (struct record_list *)v;
 		struct list_node *iter;
+		int ver = 0;
 
-		LIST_FOR_EACH(record_list_records(rec_list), iter) {
+		LIST_FOR_EACH(record_list_records((struct record_list *)v),
+			      iter)
+			record_set_version(list_node_data(iter), ver++);
+	}
+
+	hash_iter_init(db, &iter);
+	while (hash_iter_next(&iter, NULL, &v)) {
+		struct list_node *iter;
+
+		LIST_FOR_EACH(record_list_records((struct record_list *)v),
+			      iter) {
 			struct record *rec = list_node_data(iter);
+			const char *name;
+			char *symbol;
+			obj_t *o;
+
+			name = global_string_get_move(record_file_name(rec));
+			if (rec->obj != NULL) {
+				o = rec->obj;
+				obj_walk_tree(o, record_tree_name_refs, NULL);
+			} else {
+				symbol = filenametosymbol(rec->key);
+				if (rec->link != NULL) {
+					o = obj_weak_new((char *)
+						global_string_get_move(symbol));
+					o->link = safe_strdup(rec->link);
+				} else {
+					o = obj_assembly_new((char *)
+						global_string_get_move(symbol));
+				}
+			}
 
-			record_dump(rec, dir);
+			if (hash_add(trees, name, o) < 0)
+				fail("Cannot add '%s' to the trees\n", name);
 		}
 	}
+
+	return trees;
 }
 
-static void record_db_free(struct record_db *_db)
+void record_db_free(struct record_db *_db)
 {
 	struct hash *db = (struct hash *)_db;
 
+	same_decl_free();
 	hash_free(db);
 }
 
@@ -2319,18 +3466,12 @@ static char *record_get_digest(struct record *rec)
 	char *key;
 	obj_t *obj = rec->obj;
 	const char *origin = rec->origin ? rec->origin : "";
-	int member_count = 0;
+	int member_count;
 
 	if (!obj)
 		return safe_strdup(origin);
 
-	if (obj->member_list) {
-		for (obj_list_t *member = obj->member_list->first;
-		     member != NULL;
-		     member = member->next) {
-			member_count++;
-		}
-	}
+	member_count = obj_list_len(obj->member_list);
 
 	safe_asprintf(&key,
 		      "%s.%zu.%zu.%zu.%zu.%zu.%i",
@@ -2544,6 +3685,8 @@ static void generate_symbol_defs(generate_config_t *conf)
 {
 	struct stat st;
 
+	get_file_replace_path = conf->abs_path;
+
 	if (stat(conf->kernel_dir, &st) != 0)
 		fail("Failed to stat %s: %s\n", conf->kernel_dir,
 		    strerror(errno));
@@ -2566,9 +3709,6 @@ static void generate_symbol_defs(generate_config_t *conf)
 	ksymtab_for_each(conf->symbols, print_not_found, NULL);
 
 	record_db_merge(conf->db);
-
-	record_db_dump(conf->db, conf->kabi_dir);
-	record_db_free(conf->db);
 }
 
 #define	WHITESPACE	" \t\n"
@@ -2695,20 +3835,26 @@ static void generate_usage()
 	       "    -h, --help:\t\tshow this message\n"
 	       "    -v, --verbose:\tdisplay debug information\n"
 	       "    -o, --output kabi_dir:\n\t\t\t"
-	       "where to write kabi files (default: \"output\")\n"
+	       "where to write kabi files (default: \"output\")\n\t\t\t"
+	       "a name ending with .tar or .tar.zst writes an archive\n"
 	       "    -s, --symbols symbol_file:\n\t\t\ta file containing the"
 	       " list of symbols of interest (e.g. stablelisted)\n"
 	       "    -r, --rhel:\n\t\t\trun on the RHEL build tree\n"
 	       "    -a, --abs-path abs_path:\n\t\t\t"
 	       "replace the absolute path by a relative path\n"
 	       "    -g, --generate-extra-info:\n\t\t\t"
-	       "generate extra information (declaration stack, compilation unit)\n");
+	       "generate extra information (declaration stack, compilation unit)\n"
+	       "    -c, --compare-to kabi_dir:\n\t\t\t"
+	       "compare the records to kabi_dir instead of writing\n\t\t\t"
+	       "them, with -o, write the changed ones only\n");
 	exit(1);
 }
 
 static void parse_generate_opts(int argc, char **argv, generate_config_t *conf,
 		char **symbol_file)
 {
+	bool output = false;
+
 	*symbol_file = NULL;
 	conf->rhel_tree = false;
 	conf->verbose = false;
@@ -2722,10 +3868,11 @@ static void parse_generate_opts(int argc, char **argv, generate_config_t *conf,
 		{"rhel", no_argument, 0, 'r'},
 		{"abs-path", required_argument, 0, 'a'},
 		{"generate-extra-info", no_argument, 0, 'g'},
+		{"compare-to", required_argument, 0, 'c'},
 		{0, 0, 0, 0}
 	};
 
-	while ((opt = getopt_long(argc, argv, "hvo:s:ra:m:g",
+	while ((opt = getopt_long(argc, argv, "hvo:s:ra:m:gc:",
 				  loptions, &opt_index)) != -1) {
 		switch (opt) {
 		case 'h':
@@ -2735,6 +3882,7 @@ static void parse_generate_opts(int argc, char **argv, generate_config_t *conf,
 			break;
 		case 'o':
 			conf->kabi_dir = optarg;
+			output = true;
 			break;
 		case 's':
 			*symbol_file = optarg;
@@ -2743,11 +3891,14 @@ static void parse_generate_opts(int argc, char **argv, generate_config_t *conf,
 			conf->rhel_tree = true;
 			break;
 		case 'a':
-			get_file_replace_path = optarg;
+			conf->abs_path = optarg;
 			break;
 		case 'g':
 			conf->gen_extra = true;
 			break;
+		case 'c':
+			conf->compare_to = optarg;
+			break;
 		default:
 			generate_usage();
 		}
@@ -2758,16 +3909,20 @@ static void parse_generate_opts(int argc, char **argv, generate_config_t *conf,
 
 	conf->kernel_dir = argv[optind];
 
-	rec_mkdir(conf->kabi_dir);
+	/* without -o, the compared records are not written */
+	if (conf->compare_to != NULL && !output)
+		conf->kabi_dir = NULL;
+
+	if (conf->kabi_dir != NULL && !is_archive(conf->kabi_dir))
+		rec_mkdir(conf->kabi_dir);
 }
 
-void generate(int argc, char **argv)
+/*
+ * Generate the merged records of the symbols of symbol_file, or of all the
+ * exported symbols if it is NULL, without writing them.
+ */
+struct record_db *generate_records(generate_config_t *conf, char *symbol_file)
 {
-	char *symbol_file;
-	generate_config_t *conf = safe_zmalloc(sizeof(*conf));
-
-	parse_generate_opts(argc, argv, conf, &symbol_file);
-
 	if (symbol_file != NULL) {
 		conf->symbols = read_symbols(symbol_file);
 		conf->symbol_cnt = ksymtab_len(conf->symbols);
@@ -2780,6 +3935,74 @@ void generate(int argc, char **argv)
 
 	if (symbol_file != NULL)
 		ksymtab_free(conf->symbols);
+	conf->symbols = NULL;
+
+	return conf->db;
+}
+
+/*
+ * Compare the records to the dump conf->compare_to, as compare would once
+ * they are written. The changed and added records are written if there is
+ * an output.
+ */
+static int generate_compare(generate_config_t *conf, struct record_db *db)
+{
+	struct kabi_dw_compare_options opts = { 0 };
+	struct kabi_dw_diff diff = { NULL, 0 };
+	struct hash *trees, *changed;
+	unsigned int i;
+	int ret;
+
+	trees = record_db_trees(db);
+	compare_trees(conf->compare_to, trees, &opts, &diff);
+	compare_print_diff(&diff);
+
+	if (conf->kabi_dir != NULL) {
+		changed = hash_new(64, NULL);
+		if (changed == NULL)
+			fail("Cannot create the changed records hash\n");
+		for (i = 0; i < diff.count; i++) {
+			char *file = diff.changes[i].file;
+
+			if (diff.changes[i].type != KABI_DW_REMOVED &&
+			    hash_add(changed, file, file) < 0)
+				fail("Cannot add '%s' to the changed records\n",
+				     file);
+		}
+		record_db_dump_only(db, conf->kabi_dir, changed);
+		hash_free(changed);
+	}
+
+	ret = 0;
+	for (i = 0; i < diff.count; i++) {
+		if (diff.changes[i].type != KABI_DW_ADDED)
+			ret = EXIT_KABI_CHANGE;
+		free(diff.changes[i].file);
+		free(diff.changes[i].report);
+	}
+	free(diff.changes);
+	hash_free(trees);
+
+	return ret;
+}
+
+int generate(int argc, char **argv)
+{
+	char *symbol_file;
+	generate_config_t *conf = safe_zmalloc(sizeof(*conf));
+	struct record_db *db;
+	int ret = 0;
+
+	parse_generate_opts(argc, argv, conf, &symbol_file);
+
+	db = generate_records(conf, symbol_file);
+	if (conf->compare_to != NULL)
+		ret = generate_compare(conf, db);
+	else
+		record_db_dump(db, conf->kabi_dir);
+	record_db_free(db);
 
 	free(conf);
+
+	return ret;
 }
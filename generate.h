@@ -18,8 +18,33 @@
 #ifndef GENERATE_H_
 #define	GENERATE_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #include "main.h"
 
-void generate(int argc, char **argv);
+struct ksymtab;
+struct record_db;
+struct hash;
+
+typedef struct {
+	char *kernel_dir; /* Path to  the kernel modules to process */
+	char *kabi_dir; /* Where to put the output */
+	char *abs_path; /* Prefix replaced in the source paths */
+	char *compare_to; /* Dump to compare the records to */
+	struct ksymtab *symbols; /* List of symbols to generate */
+	size_t symbol_cnt;
+	struct record_db *db;
+	bool rhel_tree;
+	bool verbose;
+	bool gen_extra;
+} generate_config_t;
+
+int generate(int argc, char **argv);
+struct record_db *generate_records(generate_config_t *conf, char *symbol_file);
+void record_db_dump(struct record_db *db, char *dir);
+void record_db_dump_only(struct record_db *db, char *dir, struct hash *only);
+struct hash *record_db_trees(struct record_db *db);
+void record_db_free(struct record_db *db);
 
 #endif /* GENERATE_H_ */
@@ -0,0 +1,101 @@
+/*
+	Copyright(C) 2017, Red Hat, Inc.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * libkabi-dw: the generate and compare commands as function calls.
+ *
+ * The functions return 0 on success and -1 on failure, the message of the
+ * failure is then returned by kabi_dw_error(). A failed comparison closes
+ * the dumps and the cache it had opened, but what a failed call had
+ * allocated is not freed.
+ *
+ * The calls must not run concurrently.
+ */
+
+#ifndef KABI_DW_H_
+#define KABI_DW_H_
+
+#include <stdbool.h>
+
+/* The records generated from the kernel, in memory */
+struct kabi_dw_records;
+
+/* The options of the generate command */
+struct kabi_dw_generate_options {
+	const char *kernel_dir;	/* the kernel modules, or a single one */
+	const char *symbol_file; /* the symbols of interest, NULL for all */
+	const char *abs_path;	/* replaced by a relative path */
+	bool rhel_tree;
+	bool gen_extra;		/* declaration stack, compilation unit */
+	bool verbose;
+};
+
+/* The options of the compare command */
+struct kabi_dw_compare_options {
+	bool hide_kabi;
+	bool hide_kabi_new;
+	bool follow;
+	bool skip_duplicate;
+	bool no_offset;
+	bool no_replaced;
+	bool no_shifted;
+	bool no_inserted;
+	bool no_deleted;
+	bool no_added;
+	bool no_removed;
+	bool no_moved_files;
+};
+
+enum kabi_dw_change_type {
+	KABI_DW_CHANGED,	/* the file differs */
+	KABI_DW_REMOVED,	/* the file is missing from the new dump */
+	KABI_DW_ADDED,		/* the file is new, not a breakage */
+};
+
+struct kabi_dw_change {
+	enum kabi_dw_change_type type;
+	char *file;	/* relative to the dumps */
+	char *report;	/* as printed by compare, NULL unless changed */
+};
+
+/*
+ * The changes found by a comparison, none but added files if the dumps are
+ * compatible
+ */
+struct kabi_dw_diff {
+	struct kabi_dw_change *changes;
+	unsigned int count;
+};
+
+const char *kabi_dw_error(void);
+
+int kabi_dw_generate(const struct kabi_dw_generate_options *opts,
+		     struct kabi_dw_records **records);
+int kabi_dw_records_write(struct kabi_dw_records *records,
+			  const char *kabi_dir);
+void kabi_dw_records_free(struct kabi_dw_records *records);
+
+int kabi_dw_compare(const char *old_dir, const char *new_dir,
+		    const struct kabi_dw_compare_options *opts,
+		    struct kabi_dw_diff **diff);
+int kabi_dw_compare_records(const char *old_dir,
+			    struct kabi_dw_records *records,
+			    const struct kabi_dw_compare_options *opts,
+			    struct kabi_dw_diff **diff);
+void kabi_dw_diff_free(struct kabi_dw_diff *diff);
+
+#endif /* KABI_DW_H_ */
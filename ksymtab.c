@@ -88,14 +88,12 @@ static int elf_get_section(Elf *elf,
 	 * So we reject such stuff. We only support fresh output from the
 	 * kernel build.
 	 */
-	if (shdr.sh_type == SHT_NOBITS) {
-		printf("The %s section has type SHT_NOBITS. Most likely you're "
+	if (shdr.sh_type == SHT_NOBITS)
+		fail("The %s section has type SHT_NOBITS. Most likely you're "
 		    "running this tool on modules coming from kernel-debuginfo "
 		    "packages. They don't contain the %s section, you need to "
 		    "use the raw modules before they are stripped\n", section,
 		    section);
-		exit(1);
-	}
 
 	if (gelf_getshdr(scn, &shdr) != &shdr)
 		fail("getshdr() failed: %s\n", elf_errmsg(-1));
@@ -0,0 +1,412 @@
+/*
+	Copyright(C) 2016, Red Hat, Inc., Jerome Marchand
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Scanner of the kabi files
+ *
+ * The whole file is scanned in place, from the memory it was read or
+ * mapped to: the token boundaries are found with a table of character
+ * classes, the strings end is found with memchr(), and the identifiers and
+ * strings are interned straight from the buffer, see global_string_get_n().
+ * Nothing is read past the end of the buffer.
+ *
+ * It follows the rules of a flex scanner: the longest match wins, the
+ * first rule on a tie. The start conditions are:
+ *
+ * LEX_INITIAL:		the header fields
+ * LEX_SYMBOL:		the symbol, after "Symbol:\n", with its keywords
+ * LEX_IN_STRING:	between double quotes
+ * LEX_UNKNOWN_FIELD:	the rest of the line of an unknown header field
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+#include "parser.tab.h"
+#include "utils.h"
+
+enum {
+	LEX_INITIAL,
+	LEX_SYMBOL,
+	LEX_IN_STRING,
+	LEX_UNKNOWN_FIELD,
+};
+
+/* Character classes */
+enum {
+	C_IDENT_FIRST = 1 << 0,	/* [a-zA-Z_] */
+	C_IDENT = 1 << 1,	/* [a-zA-Z0-9_] */
+	C_FILE = 1 << 2,	/* [a-zA-Z0-9_/<>\-\.] */
+	C_HEX = 1 << 3,		/* [a-fA-F0-9] */
+	C_NUM = 1 << 4,		/* [0-9] */
+	C_SPACE = 1 << 5,	/* [ \t\v\f] */
+	C_CHAR = 1 << 6,	/* [{}()\[\];:,.*@=-], returned as is */
+};
+
+/* The rules, in the order they are tried on a tie */
+enum {
+	R_NONE,
+	R_KEYWORD,
+	R_HEADER,
+	R_FIELD,
+	R_FIELD_LINE,
+	R_ARROW,
+	R_SRCFILE,
+	R_IDENTIFIER,
+	R_NULL,
+	R_HEX,
+	R_NUM,
+	R_CHAR,
+	R_NEWLINE,
+	R_SPACE,
+	R_QUOTE,
+	R_OTHER,
+};
+
+struct lexer_keyword {
+	const char *s;
+	size_t len;
+	int token;
+};
+
+#define KEYWORD(s, token) { s, sizeof(s) - 1, token }
+
+/* Keywords of the symbol */
+static const struct lexer_keyword symbol_keywords[] = {
+	KEYWORD("const", CONST),
+	KEYWORD("enum", ENUM),
+	KEYWORD("struct", STRUCT),
+	KEYWORD("typedef", TYPEDEF),
+	KEYWORD("union", UNION),
+	KEYWORD("volatile", VOLATILE),
+	KEYWORD("...", ELLIPSIS),
+};
+
+/* Keywords used only in the header */
+static const struct lexer_keyword header_keywords[] = {
+	KEYWORD("Version:", VERSION_KW),
+	KEYWORD("CU:", CU_KW),
+	KEYWORD("File:", FILE_KW),
+	KEYWORD("Stack:", STACK_KW),
+	KEYWORD("Symbol:\n", SYMBOL_KW_NL),
+};
+
+struct lexer_match {
+	size_t len;
+	int rule;
+	int token;
+};
+
+static struct {
+	const char *p;
+	const char *end;
+	int state;
+	int last_state;		/* state to get back to after a string */
+} lexer;
+
+static unsigned char lexer_class[256];
+
+static void lexer_init_classes(void)
+{
+	const char *s;
+	int c;
+
+	for (c = 'a'; c <= 'z'; c++) {
+		lexer_class[c] |= C_IDENT_FIRST | C_IDENT | C_FILE;
+		lexer_class[c - 'a' + 'A'] |= C_IDENT_FIRST | C_IDENT | C_FILE;
+	}
+	for (c = '0'; c <= '9'; c++)
+		lexer_class[c] |= C_IDENT | C_FILE | C_HEX | C_NUM;
+	for (c = 'a'; c <= 'f'; c++) {
+		lexer_class[c] |= C_HEX;
+		lexer_class[c - 'a' + 'A'] |= C_HEX;
+	}
+	lexer_class['_'] |= C_IDENT_FIRST | C_IDENT | C_FILE;
+	for (s = "/<>-."; *s; s++)
+		lexer_class[(unsigned char)*s] |= C_FILE;
+	for (s = " \t\v\f"; *s; s++)
+		lexer_class[(unsigned char)*s] |= C_SPACE;
+	for (s = "{}()[];:,.*@=-"; *s; s++)
+		lexer_class[(unsigned char)*s] |= C_CHAR;
+}
+
+/* Start scanning the len bytes at data */
+void lexer_start(const char *data, size_t len)
+{
+	static bool initialized;
+
+	if (!initialized) {
+		lexer_init_classes();
+		initialized = true;
+	}
+
+	lexer.p = data;
+	lexer.end = data + len;
+	lexer.state = LEX_INITIAL;
+}
+
+/* Length of the run of characters of class cls at p */
+static inline size_t lexer_run(const char *p, unsigned char cls)
+{
+	const char *q = p;
+
+	while (q < lexer.end && lexer_class[(unsigned char)*q] & cls)
+		q++;
+
+	return q - p;
+}
+
+static inline bool lexer_prefix(const char *p, const char *s, size_t len)
+{
+	return (size_t)(lexer.end - p) >= len && memcmp(p, s, len) == 0;
+}
+
+/* Keep the longest match, the first one on a tie */
+static inline void lexer_candidate(struct lexer_match *m, size_t len,
+				   int rule, int token)
+{
+	if (len > m->len) {
+		m->len = len;
+		m->rule = rule;
+		m->token = token;
+	}
+}
+
+static void lexer_keywords(struct lexer_match *m, const char *p,
+			   const struct lexer_keyword *keywords,
+			   unsigned int count, int rule)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		if (lexer_prefix(p, keywords[i].s, keywords[i].len))
+			lexer_candidate(m, keywords[i].len, rule,
+					keywords[i].token);
+	}
+}
+
+/* The header rules: the keywords and {IDENT}+":" */
+static void lexer_header(struct lexer_match *m, const char *p)
+{
+	size_t len;
+
+	lexer_keywords(m, p, header_keywords,
+		       sizeof(header_keywords) / sizeof(*header_keywords),
+		       R_HEADER);
+
+	len = lexer_run(p, C_IDENT);
+	if (len > 0 && p + len < lexer.end && p[len] == ':')
+		lexer_candidate(m, len + 1, R_FIELD, 0);
+}
+
+/*
+ * The lines ignored in an unknown field:
+ *   [^\n:]*"\n"
+ *   {IDENT}*[^a-zA-Z0-9_\n:]+{IDENT}*[^\n]*"\n"
+ * Both match up to the end of the line. The second one does when the
+ * first character which is not an identifier one is neither ':' nor '\n'.
+ */
+static void lexer_field_line(struct lexer_match *m, const char *p)
+{
+	const char *nl = memchr(p, '\n', lexer.end - p);
+	const char *q;
+
+	if (nl == NULL)
+		return;
+
+	q = p + lexer_run(p, C_IDENT);
+	if (memchr(p, ':', nl - p) == NULL ||
+	    (q < nl && *q != ':'))
+		lexer_candidate(m, nl - p + 1, R_FIELD_LINE, 0);
+}
+
+/* {FILECHAR}+"."[chS], the longest one */
+static size_t lexer_srcfile(const char *p)
+{
+	size_t len = lexer_run(p, C_FILE);
+
+	for (; len >= 3; len--) {
+		char c = p[len - 1];
+
+		if (p[len - 2] == '.' && (c == 'c' || c == 'h' || c == 'S'))
+			return len;
+	}
+
+	return 0;
+}
+
+static void lexer_match(struct lexer_match *m, const char *p)
+{
+	unsigned char cls = lexer_class[(unsigned char)*p];
+	size_t len;
+
+	if (lexer.state == LEX_SYMBOL)
+		lexer_keywords(m, p, symbol_keywords,
+			       sizeof(symbol_keywords) /
+			       sizeof(*symbol_keywords), R_KEYWORD);
+	else
+		lexer_header(m, p);
+
+	if (lexer_prefix(p, "->", 2))
+		lexer_candidate(m, 2, R_ARROW, 0);
+
+	if (cls & C_FILE)
+		lexer_candidate(m, lexer_srcfile(p), R_SRCFILE, 0);
+	if (lexer_prefix(p, "<built-in>", 10))
+		lexer_candidate(m, 10, R_SRCFILE, 0);
+
+	if (cls & C_IDENT_FIRST)
+		lexer_candidate(m, lexer_run(p, C_IDENT), R_IDENTIFIER, 0);
+
+	if (lexer_prefix(p, "(NULL)", 6))
+		lexer_candidate(m, 6, R_NULL, 0);
+
+	if (lexer.end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') &&
+	    (len = lexer_run(p + 2, C_HEX)) > 0)
+		lexer_candidate(m, len + 2, R_HEX, 0);
+	if (cls & C_NUM)
+		lexer_candidate(m, lexer_run(p, C_NUM), R_NUM, 0);
+
+	if (cls & C_CHAR)
+		lexer_candidate(m, 1, R_CHAR, 0);
+	else if (*p == '\n')
+		lexer_candidate(m, 1, R_NEWLINE, 0);
+	else if (cls & C_SPACE)
+		lexer_candidate(m, 1, R_SPACE, 0);
+	else if (*p == '"')
+		lexer_candidate(m, 1, R_QUOTE, 0);
+	else
+		lexer_candidate(m, 1, R_OTHER, 0);
+}
+
+/* The token is not '\0' terminated, strtoul() could read past it */
+static unsigned long lexer_number(const char *p, size_t len, int base)
+{
+	unsigned long val = 0;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		char c = p[i] | 0x20;	/* lower case */
+
+		val = val * base + (c >= 'a' ? c - 'a' + 10 : c - '0');
+	}
+
+	return val;
+}
+
+static char *lexer_string(const char *p, size_t len)
+{
+	/* interned, so the parser must not free it */
+	return (char *)global_string_get_n(p, len);
+}
+
+int yylex(void)
+{
+	for (;;) {
+		struct lexer_match m = { 0, R_NONE, 0 };
+		const char *p = lexer.p;
+		const char *q;
+
+		if (p >= lexer.end) {
+			/* get back to initial condition for the next file */
+			lexer.state = LEX_INITIAL;
+			return 0;
+		}
+
+		if (lexer.state == LEX_IN_STRING) {
+			if (*p == '"') {
+				lexer.p++;
+				lexer.state = lexer.last_state;
+				continue;
+			}
+
+			q = memchr(p, '"', lexer.end - p);
+			if (q == NULL)
+				q = lexer.end;
+			yylval.str = lexer_string(p, q - p);
+			lexer.p = q;
+			debug("String: %s\n", yylval.str);
+			return STRING;
+		}
+
+		if (lexer.state == LEX_UNKNOWN_FIELD) {
+			lexer_header(&m, p);
+			lexer_field_line(&m, p);
+		} else {
+			lexer_match(&m, p);
+		}
+
+		lexer.p += m.len;
+
+		switch (m.rule) {
+		case R_NONE:
+			/* like the flex default rule */
+			putchar(*p);
+			lexer.p++;
+			break;
+		case R_KEYWORD:
+			return m.token;
+		case R_HEADER:
+			lexer.state = m.token == SYMBOL_KW_NL ?
+				LEX_SYMBOL : LEX_INITIAL;
+			return m.token;
+		case R_FIELD:
+			lexer.state = LEX_UNKNOWN_FIELD;
+			break;
+		case R_FIELD_LINE:
+			break;
+		case R_ARROW:
+			return ARROW;
+		case R_SRCFILE:
+			yylval.str = lexer_string(p, m.len);
+			debug("Source file: %s\n", yylval.str);
+			return SRCFILE;
+		case R_IDENTIFIER:
+			yylval.str = lexer_string(p, m.len);
+			debug("Identifier: %s\n", yylval.str);
+			return IDENTIFIER;
+		case R_NULL:
+			yylval.str = NULL;
+			debug("Identifier: (NULL)\n");
+			return IDENTIFIER;
+		case R_HEX:
+			yylval.ul = lexer_number(p + 2, m.len - 2, 16);
+			debug("Constant: 0x%lx\n", yylval.ul);
+			return CONSTANT;
+		case R_NUM:
+			yylval.ul = lexer_number(p, m.len, 10);
+			debug("Constant: %li\n", yylval.ul);
+			return CONSTANT;
+		case R_CHAR:
+			return *p;
+		case R_NEWLINE:
+			return NEWLINE;
+		case R_SPACE:
+			break;
+		case R_QUOTE:
+			lexer.last_state = lexer.state;
+			lexer.state = LEX_IN_STRING;
+			break;
+		case R_OTHER:
+			printf("Unexpected entry \"%c\"\n", *p);
+			break;
+		}
+	}
+}
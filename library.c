@@ -0,0 +1,167 @@
+/*
+	Copyright(C) 2017, Red Hat, Inc.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * The functions of libkabi-dw, see kabi-dw.h.
+ *
+ * Each call sets fail_jmp, so that fail() returns to it rather than
+ * exiting.
+ */
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "kabi-dw.h"
+#include "generate.h"
+#include "compare.h"
+#include "archive.h"
+#include "hash.h"
+#include "utils.h"
+
+/* The strings are kept as long as the records and trees using them */
+static void library_init(void)
+{
+	static bool ready;
+
+	if (!ready) {
+		global_string_keeper_init();
+		ready = true;
+	}
+}
+
+const char *kabi_dw_error(void)
+{
+	return fail_message();
+}
+
+int kabi_dw_generate(const struct kabi_dw_generate_options *opts,
+		     struct kabi_dw_records **records)
+{
+	generate_config_t conf = { 0 };
+	jmp_buf jmp;
+
+	library_init();
+	fail_jmp = &jmp;
+	if (setjmp(jmp) != 0) {
+		fail_jmp = NULL;
+		return -1;
+	}
+
+	conf.kernel_dir = (char *)opts->kernel_dir;
+	conf.abs_path = (char *)opts->abs_path;
+	conf.rhel_tree = opts->rhel_tree;
+	conf.gen_extra = opts->gen_extra;
+	conf.verbose = opts->verbose;
+	*records = (struct kabi_dw_records *)
+		generate_records(&conf, (char *)opts->symbol_file);
+
+	fail_jmp = NULL;
+	return 0;
+}
+
+/* Write the records as generate does, kabi_dir can name an archive */
+int kabi_dw_records_write(struct kabi_dw_records *records,
+			  const char *kabi_dir)
+{
+	jmp_buf jmp;
+
+	library_init();
+	fail_jmp = &jmp;
+	if (setjmp(jmp) != 0) {
+		fail_jmp = NULL;
+		return -1;
+	}
+
+	if (!is_archive(kabi_dir))
+		rec_mkdir((char *)kabi_dir);
+	record_db_dump((struct record_db *)records, (char *)kabi_dir);
+
+	fail_jmp = NULL;
+	return 0;
+}
+
+void kabi_dw_records_free(struct kabi_dw_records *records)
+{
+	record_db_free((struct record_db *)records);
+}
+
+/* Compare two dumps, directories or archives, as compare does */
+int kabi_dw_compare(const char *old_dir, const char *new_dir,
+		    const struct kabi_dw_compare_options *opts,
+		    struct kabi_dw_diff **diff)
+{
+	jmp_buf jmp;
+
+	library_init();
+	*diff = safe_zmalloc(sizeof(**diff));
+	fail_jmp = &jmp;
+	if (setjmp(jmp) != 0) {
+		fail_jmp = NULL;
+		compare_close();
+		return -1;
+	}
+
+	compare_dumps((char *)old_dir, (char *)new_dir, opts, *diff);
+
+	fail_jmp = NULL;
+	return 0;
+}
+
+/*
+ * Compare the dump old_dir to the records, as if they were written. The
+ * kABI trickery is not hidden.
+ */
+int kabi_dw_compare_records(const char *old_dir,
+			    struct kabi_dw_records *records,
+			    const struct kabi_dw_compare_options *opts,
+			    struct kabi_dw_diff **diff)
+{
+	struct hash *trees;
+	jmp_buf jmp;
+
+	library_init();
+	*diff = safe_zmalloc(sizeof(**diff));
+	fail_jmp = &jmp;
+	if (setjmp(jmp) != 0) {
+		fail_jmp = NULL;
+		compare_close();
+		return -1;
+	}
+
+	trees = record_db_trees((struct record_db *)records);
+	compare_trees((char *)old_dir, trees, opts, *diff);
+	hash_free(trees);
+
+	fail_jmp = NULL;
+	return 0;
+}
+
+void kabi_dw_diff_free(struct kabi_dw_diff *diff)
+{
+	unsigned int i;
+
+	if (diff == NULL)
+		return;
+
+	for (i = 0; i < diff->count; i++) {
+		free(diff->changes[i].file);
+		free(diff->changes[i].report);
+	}
+	free(diff->changes);
+	free(diff);
+}
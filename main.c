@@ -33,6 +33,8 @@
 #include "generate.h"
 #include "compare.h"
 #include "show.h"
+#include "query.h"
+#include "serve.h"
 #include "utils.h"
 
 static char *progname;
@@ -42,8 +44,10 @@ void usage(void)
 	printf("Usage:\n"
 	    "\t %s generate [options] kernel_dir\n"
 	    "\t %s show [options] kabi_file...\n"
-	    "\t %s compare [options] kabi_dir kabi_dir...\n",
-	       progname, progname, progname);
+	    "\t %s compare [options] kabi_dir kabi_dir...\n"
+	    "\t %s query [options] kabi_dir name...\n"
+	    "\t %s serve [options] socket kabi_dir...\n",
+	       progname, progname, progname, progname, progname);
 	exit(1);
 }
 
@@ -61,11 +65,15 @@ int main(int argc, char **argv)
 	global_string_keeper_init();
 
 	if (strcmp(argv[0], "generate") == 0)
-		generate(argc, argv);
+		ret = generate(argc, argv);
 	else if (strcmp(argv[0], "compare") == 0)
 		ret = compare(argc, argv);
 	else if (strcmp(argv[0], "show") == 0)
 		ret = show(argc, argv);
+	else if (strcmp(argv[0], "query") == 0)
+		ret = query(argc, argv);
+	else if (strcmp(argv[0], "serve") == 0)
+		ret = serve(argc, argv);
 	else
 		usage();
 
@@ -37,6 +37,13 @@
 /* Path used for DW_AT_declaration, ie. those we don't have */
 #define	DECLARATION_PATH	"<declarations>"
 
+/* Hashes of the record files, see manifest.h */
+#define	MANIFEST_FILE		"MANIFEST"
+/* Checksums of the exported symbols, see manifest.h */
+#define	CHECKSUMS_FILE		"CHECKSUMS"
+/* Reverse references between the record files, see manifest.h */
+#define	DEPENDENTS_FILE		"DEPENDENTS"
+
 #define RH_KABI_HIDE		"__UNIQUE_ID_rh_kabi_hide"
 #define RH_KABI_HIDE_LEN	24
 
@@ -0,0 +1,299 @@
+/*
+	Copyright(C) 2016, Red Hat, Inc., Stanislav Kozina
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Manifest of a kABI dump
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main.h"
+#include "manifest.h"
+#include "archive.h"
+#include "buffer.h"
+#include "hash.h"
+#include "utils.h"
+
+#define MANIFEST_HASH_SIZE 4096
+
+struct manifest_entry {
+	uint64_t hash;
+	uint64_t checksum;
+	size_t size;
+	unsigned int index;
+	unsigned int *dependents;
+	unsigned int ndependents;
+	char name[];
+};
+
+struct manifest {
+	struct hash *names;
+	struct manifest_entry **entries;	/* in the manifest order */
+	unsigned int count;
+	unsigned int size;
+	bool has_dependents;
+};
+
+uint64_t manifest_hash_update(uint64_t h, const char *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= (unsigned char)data[i];
+		h *= 0x100000001b3ULL;
+	}
+
+	return h;
+}
+
+/* zero-padded, so that the lines are aligned */
+static void put_hash(struct buffer *buf, uint64_t hash)
+{
+	static const char digits[] = "0123456789abcdef";
+	unsigned int shift;
+
+	for (shift = 64; shift > 0; shift -= 4)
+		buffer_putc(buf, digits[(hash >> (shift - 4)) & 0xf]);
+	buffer_putc(buf, ' ');
+}
+
+void manifest_put(struct buffer *buf, const char *name,
+		  uint64_t hash, uint64_t checksum, size_t size)
+{
+	put_hash(buf, hash);
+	put_hash(buf, checksum);
+	buffer_put_uint(buf, size);
+	buffer_putc(buf, ' ');
+	buffer_puts(buf, name);
+	buffer_putc(buf, '\n');
+}
+
+void manifest_put_checksum(struct buffer *buf, const char *symbol,
+			   uint64_t checksum)
+{
+	put_hash(buf, checksum);
+	buffer_puts(buf, symbol);
+	buffer_putc(buf, '\n');
+}
+
+struct manifest *manifest_read(FILE *file, const char *path)
+{
+	struct manifest *m = safe_zmalloc(sizeof(*m));
+	char *line = NULL;
+	size_t len = 0;
+	ssize_t n;
+
+	m->names = hash_new(MANIFEST_HASH_SIZE, NULL);
+	if (m->names == NULL)
+		fail("Cannot create the manifest hash\n");
+
+	while ((n = getline(&line, &len, file)) > 0) {
+		struct manifest_entry *e;
+		uint64_t hash, checksum;
+		size_t size;
+		int pos;
+
+		if (line[n - 1] == '\n')
+			line[--n] = '\0';
+
+		if (sscanf(line, "%" SCNx64 " %" SCNx64 " %zu %n",
+			   &hash, &checksum, &size, &pos) < 3)
+			fail("Malformed manifest line in '%s': %s\n",
+			     path, line);
+
+		e = safe_zmalloc(sizeof(*e) + n - pos + 1);
+		e->hash = hash;
+		e->checksum = checksum;
+		e->size = size;
+		memcpy(e->name, line + pos, n - pos + 1);
+
+		if (m->count == m->size) {
+			m->size = m->size ? m->size * 2 : 1024;
+			m->entries = safe_realloc(m->entries, m->size *
+						  sizeof(*m->entries));
+		}
+		e->index = m->count;
+		m->entries[m->count++] = e;
+
+		if (hash_add(m->names, e->name, e) < 0)
+			fail("Cannot add '%s' to the manifest hash\n",
+			     e->name);
+	}
+	free(line);
+
+	return m;
+}
+
+static struct manifest_entry *manifest_get(struct manifest *m,
+					   const char *name, const char *path)
+{
+	struct manifest_entry *e = hash_find(m->names, name);
+
+	if (e == NULL)
+		fail("File '%s' from '%s' is not in the manifest\n",
+		     name, path);
+
+	return e;
+}
+
+/* Read the DEPENDENTS_FILE of the dump */
+void manifest_read_dependents(struct manifest *m, FILE *file,
+			      const char *path)
+{
+	char *line = NULL;
+	size_t len = 0;
+	ssize_t n;
+
+	while ((n = getline(&line, &len, file)) > 0) {
+		struct manifest_entry *e;
+		char *tok, *saveptr;
+		unsigned int size = 0;
+
+		if (line[n - 1] == '\n')
+			line[--n] = '\0';
+
+		tok = strtok_r(line, " ", &saveptr);
+		if (tok == NULL)
+			continue;
+		e = manifest_get(m, tok, path);
+
+		while ((tok = strtok_r(NULL, " ", &saveptr)) != NULL) {
+			if (e->ndependents == size) {
+				size = size ? size * 2 : 4;
+				e->dependents = safe_realloc(e->dependents,
+					size * sizeof(*e->dependents));
+			}
+			e->dependents[e->ndependents++] =
+				manifest_get(m, tok, path)->index;
+		}
+	}
+	free(line);
+
+	m->has_dependents = true;
+}
+
+/*
+ * Read the manifest of the kabi directory dir (or archive ar), if generate
+ * wrote one.
+ */
+struct manifest *manifest_load(char *dir, struct archive *ar)
+{
+	struct manifest *m;
+	char *path;
+	FILE *file;
+
+	if (!kabi_exists(dir, ar, MANIFEST_FILE))
+		return NULL;
+
+	file = kabi_fopen(dir, ar, MANIFEST_FILE, &path);
+	m = manifest_read(file, path);
+	fclose(file);
+	free(path);
+
+	if (!kabi_exists(dir, ar, DEPENDENTS_FILE))
+		return m;
+
+	file = kabi_fopen(dir, ar, DEPENDENTS_FILE, &path);
+	manifest_read_dependents(m, file, path);
+	fclose(file);
+	free(path);
+
+	return m;
+}
+
+void manifest_free(struct manifest *m)
+{
+	unsigned int i;
+
+	if (m == NULL)
+		return;
+
+	for (i = 0; i < m->count; i++) {
+		free(m->entries[i]->dependents);
+		free(m->entries[i]);
+	}
+	free(m->entries);
+	hash_free(m->names);
+	free(m);
+}
+
+unsigned int manifest_count(struct manifest *m)
+{
+	return m->count;
+}
+
+const char *manifest_name(struct manifest *m, unsigned int i)
+{
+	return m->entries[i]->name;
+}
+
+bool manifest_has_dependents(struct manifest *m)
+{
+	return m->has_dependents;
+}
+
+/* Indexes of the files referencing the i-th file */
+unsigned int manifest_dependents(struct manifest *m, unsigned int i,
+				 const unsigned int **dependents)
+{
+	*dependents = m->entries[i]->dependents;
+
+	return m->entries[i]->ndependents;
+}
+
+/* Hash of the content of name, or with deep its checksum */
+bool manifest_lookup(struct manifest *m, const char *name, bool deep,
+		     uint64_t *hash)
+{
+	struct manifest_entry *e;
+
+	if (m == NULL)
+		return false;
+
+	e = hash_find(m->names, name);
+	if (e == NULL)
+		return false;
+
+	*hash = deep ? e->checksum : e->hash;
+
+	return true;
+}
+
+/*
+ * Do both manifests list the files with the same content? If deep is set,
+ * the files they reference must be the same too.
+ */
+bool manifest_same(struct manifest *m1, const char *name1,
+		   struct manifest *m2, const char *name2, bool deep)
+{
+	struct manifest_entry *e1, *e2;
+
+	if (m1 == NULL || m2 == NULL)
+		return false;
+
+	e1 = hash_find(m1->names, name1);
+	e2 = hash_find(m2->names, name2);
+	if (e1 == NULL || e2 == NULL)
+		return false;
+
+	if (deep)
+		return e1->checksum == e2->checksum;
+
+	return e1->hash == e2->hash && e1->size == e2->size;
+}
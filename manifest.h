@@ -0,0 +1,83 @@
+/*
+	Copyright(C) 2016, Red Hat, Inc., Stanislav Kozina
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Manifest of a kABI dump
+ *
+ * generate writes the MANIFEST_FILE next to the records. It has one line
+ * per record file, giving the hash of its content, its checksum (which
+ * covers the type but not where it was declared, and all the records it
+ * references), its size and its path relative to the kabi directory:
+ *
+ * 0123456789abcdef fedcba9876543210 1234 struct--foo.txt
+ *
+ * compare uses it to skip the files that are the same in both dumps.
+ *
+ * The CHECKSUMS_FILE lists the checksums of the exported symbols:
+ *
+ * fedcba9876543210 foo
+ *
+ * The DEPENDENTS_FILE gives, for each file referenced by others, the files
+ * referencing it:
+ *
+ * struct--foo.txt func--bar.txt struct--baz.txt
+ */
+
+#ifndef MANIFEST_H_
+#define MANIFEST_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+struct archive;
+struct buffer;
+struct manifest;
+
+/* 64-bit FNV-1a */
+#define MANIFEST_HASH_INIT 0xcbf29ce484222325ULL
+
+uint64_t manifest_hash_update(uint64_t hash, const char *data, size_t len);
+
+static inline uint64_t manifest_hash(const char *data, size_t len)
+{
+	return manifest_hash_update(MANIFEST_HASH_INIT, data, len);
+}
+
+void manifest_put(struct buffer *buf, const char *name,
+		  uint64_t hash, uint64_t checksum, size_t size);
+void manifest_put_checksum(struct buffer *buf, const char *symbol,
+			   uint64_t checksum);
+
+struct manifest *manifest_read(FILE *file, const char *path);
+void manifest_read_dependents(struct manifest *m, FILE *file,
+			      const char *path);
+struct manifest *manifest_load(char *dir, struct archive *ar);
+void manifest_free(struct manifest *m);
+
+unsigned int manifest_count(struct manifest *m);
+const char *manifest_name(struct manifest *m, unsigned int i);
+bool manifest_has_dependents(struct manifest *m);
+unsigned int manifest_dependents(struct manifest *m, unsigned int i,
+				 const unsigned int **dependents);
+bool manifest_lookup(struct manifest *m, const char *name, bool deep,
+		     uint64_t *hash);
+bool manifest_same(struct manifest *m1, const char *name1,
+		   struct manifest *m2, const char *name2, bool deep);
+
+#endif /* MANIFEST_H_ */
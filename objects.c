@@ -39,59 +39,93 @@
 #include "utils.h"
 #include "main.h"
 #include "record.h"
+#include "hash.h"
+#include "buffer.h"
 
 /* Indentation offset for c-style and tree debug outputs */
 #define C_INDENT_OFFSET   8
 #define DBG_INDENT_OFFSET 4
 
-obj_list_t *obj_list_new(obj_t *obj)
-{
-	obj_list_t *list = safe_zmalloc(sizeof(obj_list_t));
-	list->member = obj;
-	list->next = NULL;
-	return list;
-}
-
-static void obj_list_init(obj_list_head_t *head, obj_t *obj)
-{
-	obj_list_t *list = obj_list_new(obj);
-	head->first = head->last = list;
-}
+#define OBJ_LIST_INITIAL_SIZE 4
 
 obj_list_head_t *obj_list_head_new(obj_t *obj)
 {
 	obj_list_head_t *h = safe_zmalloc(sizeof(obj_list_head_t));
 
-	obj_list_init(h, obj);
+	obj_list_add(h, obj);
 
 	return h;
 }
 
-static bool obj_list_empty(obj_list_head_t *head)
+void obj_list_add(obj_list_head_t *head, obj_t *obj)
 {
-	return head->first == NULL;
+	if (head->len == head->size) {
+		head->size = head->size ? head->size * 2 :
+			OBJ_LIST_INITIAL_SIZE;
+		head->member = safe_realloc(head->member,
+					    head->size * sizeof(obj_t *));
+	}
+
+	head->member[head->len++] = obj;
 }
 
-void obj_list_add(obj_list_head_t *head, obj_t *obj)
+/*
+ * Nodes are carved out of big chunks instead of being malloc()ed one by one.
+ * The nodes of a tree are created together, so they end up next to each
+ * other in memory and tree walks stay mostly within a few cache lines, and
+ * the malloc() header of every node is saved. Freed nodes go to a free list
+ * and are reused for the next trees.
+ */
+#define OBJ_CHUNK_NODES 1024
+
+union obj_slot {
+	obj_t obj;
+	union obj_slot *next;
+};
+
+struct obj_chunk {
+	struct obj_chunk *next;
+	union obj_slot slots[OBJ_CHUNK_NODES];
+};
+
+static struct obj_chunk *obj_chunks;
+static unsigned int obj_chunk_used = OBJ_CHUNK_NODES;
+static union obj_slot *obj_free_slots;
+
+static obj_t *obj_alloc(void)
 {
-	obj_list_t *list;
+	union obj_slot *slot;
 
-	if (obj_list_empty(head)) {
-		obj_list_init(head, obj);
-		return;
+	if (obj_free_slots != NULL) {
+		slot = obj_free_slots;
+		obj_free_slots = slot->next;
+	} else {
+		if (obj_chunk_used == OBJ_CHUNK_NODES) {
+			struct obj_chunk *chunk;
+
+			chunk = safe_zmalloc(sizeof(*chunk));
+			chunk->next = obj_chunks;
+			obj_chunks = chunk;
+			obj_chunk_used = 0;
+		}
+		slot = &obj_chunks->slots[obj_chunk_used++];
 	}
-	list = obj_list_new(obj);
 
-	if (head->last->next)
-		fprintf(stderr, "head->last is not the last\n");
+	memset(slot, 0, sizeof(*slot));
+	return &slot->obj;
+}
+
+static void obj_dealloc(obj_t *o)
+{
+	union obj_slot *slot = (union obj_slot *)o;
 
-	head->last->next = list;
-	head->last = list;
+	slot->next = obj_free_slots;
+	obj_free_slots = slot;
 }
 
 obj_t *obj_new(obj_types type, char *name)
 {
-	obj_t *new = safe_zmalloc(sizeof(obj_t));
+	obj_t *new = obj_alloc();
 
 	new->type = type;
 	new->name = global_string_get_move(name);
@@ -100,24 +134,20 @@ obj_t *obj_new(obj_types type, char *name)
 }
 
 static void _obj_free(obj_t *o, obj_t *skip);
+static bool obj_cons_put(obj_t *o);
 
 static void _obj_list_free(obj_list_head_t *l, obj_t *skip)
 {
-	obj_list_t *list;
-	obj_list_t *next;
+	unsigned int i;
 
 	if (l == NULL)
 		return;
 
-	list = l->first;
-	free(l);
+	for (i = 0; i < l->len; i++)
+		_obj_free(l->member[i], skip);
 
-	while (list) {
-		_obj_free(list->member, skip);
-		next = list->next;
-		free(list);
-		list = next;
-	}
+	free(l->member);
+	free(l);
 }
 
 static void obj_list_free(obj_list_head_t *l)
@@ -125,28 +155,49 @@ static void obj_list_free(obj_list_head_t *l)
 	_obj_list_free(l, NULL);
 }
 
-/*
- * Free the tree o, but keep the subtree skip.
- */
-static void _obj_free(obj_t *o, obj_t *skip)
+static int obj_free_pre_cb(obj_t *o, void *args)
 {
-	if (!o || (o == skip))
-		return;
+	obj_t *skip = args;
+
+	if (o == skip)
+		return CB_SKIP;
+
+	if (o->shared && !obj_cons_put(o))
+		return CB_SKIP;
 
 	if (o->type == __type_reffile && o->depend_rec_node) {
 		list_del(o->depend_rec_node);
 		o->depend_rec_node = NULL;
 	}
 
-	_obj_list_free(o->member_list, skip);
+	return CB_CONT;
+}
 
-	if (o->ptr)
-		_obj_free(o->ptr, skip);
+static int obj_free_post_cb(obj_t *o, void *args)
+{
+	if (o->member_list) {
+		free(o->member_list->member);
+		free(o->member_list);
+	}
 
 	if (is_weak(o))
 		free(o->link);
 
-	free(o);
+	obj_dealloc(o);
+
+	return CB_CONT;
+}
+
+/*
+ * Free the tree o, but keep the subtree skip.
+ */
+static void _obj_free(obj_t *o, obj_t *skip)
+{
+	if (!o)
+		return;
+
+	obj_walk_tree3(o, obj_free_pre_cb, NULL, obj_free_post_cb,
+		       skip, false);
 }
 
 /*
@@ -269,424 +320,221 @@ static bool is_paren_needed(obj_t *node)
 	return false;
 }
 
-static char *print_margin_offset(const char *prefix, const char *s, int depth)
+static void print_margin_offset(const char *prefix, const char *s, int depth,
+				FILE *f)
 {
-	size_t len = snprintf(NULL, 0, "%-*s", depth * C_INDENT_OFFSET, s) + 1;
-	char *ret;
-
-	if (prefix)
-		len += strlen(prefix);
-
-	if (!len)
-		return NULL;
-	ret = safe_zmalloc(len);
-
-	snprintf(ret, len, "%s%-*s",
-		 prefix ? prefix : "", depth * C_INDENT_OFFSET, s);
-
-	return ret;
+	fprintf(f, "%s%-*s", prefix ? prefix : "", depth * C_INDENT_OFFSET, s);
 }
 
-static char *print_margin(const char *prefix, int depth)
+static void print_margin(const char *prefix, int depth, FILE *f)
 {
-	return  print_margin_offset(prefix, "", depth);
+	print_margin_offset(prefix, "", depth, f);
 }
 
-/*
- * Return type for print_* functions
- *
- * Because C mixes prefix and postfix operator, the code generation from a node
- * may need to add code before, after or in the middle of the code generated by
- * subtrees. Thus we sometimes need two return two strings.
- *
- * Attention to the precedence and associativity sould be taken when
- * deciding where a specific string should be inserted
- */
-typedef struct {
-	char *prefix;
-	char *postfix;
-} pp_t;
-
-static void free_pp(pp_t pp)
+static void print_str(const char *s, FILE *f)
 {
-	free(pp.prefix);
-	free(pp.postfix);
+	if (s)
+		fputs(s, f);
 }
 
-static pp_t _print_tree(obj_t *o, int depth, bool newline, const char *prefix);
-
 /*
- * Add prefix p at the begining of string s (reallocated)
+ * The objects are displayed in a c-like format, straight into the stream.
  *
- * space: add a space between p and s
- * freep: free the string p
- */
-static char *_prefix_str(char **s, char *p, bool space, bool freep)
-{
-	size_t lenp = strlen(p), lens = 0, newlen;
-
-	if (*s)
-		lens = strlen(*s);
-	newlen = lens + lenp + 1;
-
-	if (space)
-		newlen++;
-
-	*s = safe_realloc(*s, newlen);
-
-	if (lens)
-		memmove(space ? *s+lenp+1 : *s+lenp, *s, lens + 1);
-	else
-		(*s)[lenp] = '\0';
-	memcpy(*s, p, lenp);
-	if (space)
-		(*s)[lenp] = ' ';
-
-	if (freep)
-		free(p);
-
-	return *s;
-}
-
-static char *prefix_str(char **s, char *p)
-{
-	if (!p)
-		return *s;
-	return _prefix_str(s, p, false, false);
-}
-
-static char *prefix_str_free(char **s, char *p)
-{
-	if (!p)
-		return *s;
-	return _prefix_str(s, p, false, true);
-}
-
-static char *prefix_str_space(char **s, const char *p)
-{
-	if (!p)
-		return *s;
-	/* freep is false so we can pass const char * */
-	return _prefix_str(s, (char *)p, true, false);
-}
-
-/*
- * Add suffix p at the end of string s (realocated)
+ * Because C mixes prefix and postfix operator, the code generated by a node
+ * may need to go before, after or in the middle of the code generated by
+ * its subtrees. So every node is printed in two passes: print_prefix()
+ * prints what goes before the declarator's postfix operators and
+ * print_postfix() the rest, e.g. "int (*" and ")[4]" for an int (*)[4].
+ *
+ * Attention to the precedence and associativity sould be taken when
+ * deciding where a specific string should be printed
  *
- * space: add a space between p and s
- * freep: free the string p
+ * depth:   current indentation depth
+ * newline: is this the begining of a new line?
+ * prefix:  prefix to be printed at the begining of each line
  */
-static char *_postfix_str(char **s, char *p, bool space, bool freep)
-{
-	int lenp = strlen(p), lens = 0, newlen;
-	if (*s)
-		lens = strlen(*s);
-	newlen = lens + lenp + 1;
-
-	if (space)
-		newlen++;
-
-	*s = safe_realloc(*s, newlen);
-
-	if (lens == 0)
-		(*s)[0] = '\0';
-	if (space)
-		strcat(*s, " ");
-	strcat(*s, p);
-
-	if (freep)
-		free(p);
-
-	return *s;
-}
-
-static char *postfix_str(char **s, const char *p)
-{
-	if (!p)
-		return *s;
-
-	/* freep is false so we can pass const char * */
-	return _postfix_str(s, (char *)p, false, false);
-}
-
-static char *postfix_str_free(char **s, char *p)
-{
-	if (!p)
-		return *s;
-	return _postfix_str(s, p, false, true);
-}
+static void print_prefix(obj_t *o, int depth, bool newline,
+			 const char *prefix, FILE *f);
+static void print_postfix(obj_t *o, int depth, const char *prefix, FILE *f);
 
-static pp_t print_base(obj_t *o, int depth, const char *prefix)
+static void print_line(obj_t *o, int depth, const char *prefix, FILE *f)
 {
-	pp_t ret = {NULL, NULL};
-
-	safe_asprintf(&ret.prefix, "%s ", o->base_type);
-
-	return ret;
+	print_prefix(o, depth, true, prefix, f);
+	print_postfix(o, depth, prefix, f);
 }
 
-static pp_t print_constant(obj_t *o, int depth, const char *prefix)
+static void print_line_margin(obj_t *o, int depth, const char *prefix,
+			      FILE *f)
 {
-	pp_t ret = {NULL, NULL};
-
-	safe_asprintf(&ret.prefix, "%s = %li", o->name, (long)o->constant);
+	char offstr[64];
 
-	return ret;
+	if (o->type == __type_struct_member && !display_options.no_offset) {
+		if (is_bitfield(o))
+			snprintf(offstr, sizeof(offstr), "0x%lx:%2i-%-2i ",
+				 o->offset, o->first_bit, o->last_bit);
+		else
+			snprintf(offstr, sizeof(offstr), "0x%lx ", o->offset);
+		print_margin_offset(prefix, offstr, depth, f);
+	} else {
+		print_margin(prefix, depth, f);
+	}
 }
 
-static pp_t print_reffile(obj_t *o, int depth, const char *prefix)
+static void print_reffile(obj_t *o, FILE *f)
 {
-	pp_t ret = {NULL, NULL};
-	char *s = filenametotype(o->base_type);
-
-	s = safe_realloc(s, strlen(s) + 2);
-	strcat(s, " ");
-	ret.prefix = s;
-
-	return ret;
+	fprintf(f, "%s ", global_type_get(o->base_type));
 }
 
 /* Print a struct, enum or an union */
-static pp_t print_structlike(obj_t *o, int depth, const char *prefix)
+static void print_structlike(obj_t *o, int depth, const char *prefix,
+			     FILE *f)
 {
-	pp_t ret = {NULL, NULL}, tmp;
-	obj_list_t *list = NULL;
-	char *s, *margin;
+	unsigned int i, len = obj_list_len(o->member_list);
 
 	if (o->name)
-		safe_asprintf(&s, "%s %s {\n", typetostr(o), o->name);
+		fprintf(f, "%s %s {\n", typetostr(o), o->name);
 	else
-		safe_asprintf(&s, "%s {\n", typetostr(o));
-
-	if (o->member_list)
-		list = o->member_list->first;
-	while (list) {
-		tmp = _print_tree(list->member, depth+1, true, prefix);
-		postfix_str_free(&s, tmp.prefix);
-		postfix_str_free(&s, tmp.postfix);
-		postfix_str(&s, o->type == __type_enum ? ",\n" : ";\n");
-		list = list->next;
-	}
-
-	margin = print_margin(prefix, depth);
-	postfix_str_free(&s, margin);
-	postfix_str(&s, "}");
-
-	ret.prefix = s;
-	return ret;
-}
-
-static pp_t print_func(obj_t *o, int depth, const char *prefix)
-{
-	pp_t ret = {NULL, NULL}, return_type;
-	obj_list_t *list = NULL;
-	obj_t *next = o->ptr;
-	char *s, *margin;
-	const char *name;
-
-	return_type = _print_tree(next, depth, false, prefix);
-	ret.prefix = return_type.prefix;
+		fprintf(f, "%s {\n", typetostr(o));
 
-	if (o->name)
-		name = o->name;
-	else
-		name = "";
-
-	safe_asprintf(&s, "%s(\n", name);
-
-	if (o->member_list)
-		list = o->member_list->first;
-	while (list) {
-		pp_t arg = _print_tree(list->member, depth+1, true, prefix);
-		postfix_str_free(&s, arg.prefix);
-		postfix_str_free(&s, arg.postfix);
-		list = list->next;
-		postfix_str(&s, list ? ",\n" : "\n");
+	for (i = 0; i < len; i++) {
+		print_line(o->member_list->member[i], depth+1, prefix, f);
+		fputs(o->type == __type_enum ? ",\n" : ";\n", f);
 	}
 
-	margin = print_margin(prefix, depth);
-	postfix_str_free(&s, margin);
-	postfix_str(&s, ")");
-
-	ret.postfix = s;
-	return ret;
+	print_margin(prefix, depth, f);
+	fputc('}', f);
 }
 
-static pp_t print_array(obj_t *o, int depth, const char *prefix)
+/* The arguments of a function */
+static void print_func_args(obj_t *o, int depth, const char *prefix,
+			    FILE *f)
 {
-	pp_t ret;
-	char *s;
-	obj_t *next = o->ptr;
-
-	ret = _print_tree(next, depth, false, prefix);
-
-	safe_asprintf(&s, "[%lu]", o->constant);
-	prefix_str_free(&ret.postfix, s);
-
-	return ret;
-}
+	unsigned int i, len = obj_list_len(o->member_list);
 
-static pp_t print_ptr(obj_t *o, int depth, const char *prefix)
-{
-	pp_t ret;
-	bool need_paren = is_paren_needed(o);
-	obj_t *next = o->ptr;
+	fprintf(f, "%s(\n", o->name ? o->name : "");
 
-	ret = _print_tree(next, depth, false, prefix);
-	if (need_paren) {
-		postfix_str(&ret.prefix, "(*");
-		prefix_str(&ret.postfix, ")");
-	} else
-		postfix_str(&ret.prefix, "*");
+	for (i = 0; i < len; i++) {
+		print_line(o->member_list->member[i], depth+1, prefix, f);
+		fputs(i + 1 < len ? ",\n" : "\n", f);
+	}
 
-	return ret;
+	print_margin(prefix, depth, f);
+	fputc(')', f);
 }
 
 /* Print a var or a struct_member */
-static pp_t print_varlike(obj_t *o, int depth, const char *prefix)
+static void print_varlike(obj_t *o, FILE *f)
 {
-	pp_t ret;
-	char *s = NULL;
-
 	if (is_bitfield(o))
-		safe_asprintf(&s, "%s:%i",
-			      o->name, o->last_bit - o->first_bit + 1);
+		fprintf(f, "%s:%i", o->name, o->last_bit - o->first_bit + 1);
 	else
-		s = (char *)o->name;
-
-	ret = _print_tree(o->ptr, depth, false, prefix);
-
-	if (s)
-		postfix_str(&ret.prefix, s);
-
-	if (is_bitfield(o))
-		free(s);
-
-	return ret;
-}
-
-static pp_t print_typedef(obj_t *o, int depth, const char *prefix)
-{
-	pp_t ret;
-
-	ret = _print_tree(o->ptr, depth, false, prefix);
-
-	prefix_str(&ret.prefix, "typedef ");
-	postfix_str(&ret.prefix, o->name);
-
-	return ret;
-}
-
-static pp_t print_qualifier(obj_t *o, int depth, const char *prefix)
-{
-	pp_t ret;
-
-	ret = _print_tree(o->ptr, depth, false, prefix);
-	prefix_str_space(&ret.prefix, o->base_type);
-
-	return ret;
-}
-
-static pp_t print_assembly(obj_t *o, int depth, const char *prefix)
-{
-	pp_t ret = {NULL, NULL};
-
-	prefix_str(&ret.prefix, "assembly ");
-	postfix_str(&ret.prefix, o->name);
-
-	return ret;
+		print_str(o->name, f);
 }
 
-static pp_t print_weak(obj_t *o, int depth, const char *prefix)
+static void print_ptr_child(obj_t *o, int depth, const char *prefix, FILE *f)
 {
-	pp_t ret = {NULL, NULL};
-
-	prefix_str(&ret.prefix, "weak ");
-	postfix_str(&ret.prefix, o->name);
-	postfix_str(&ret.prefix, " -> ");
-	postfix_str(&ret.prefix, o->link);
+	if (!o->ptr)
+		fail("NULL pointer in print_prefix\n");
 
-	return ret;
+	print_prefix(o->ptr, depth, false, prefix, f);
 }
 
-#define BASIC_CASE(type)				\
-	case __type_##type:				\
-		ret = print_##type(o, depth, prefix);	\
-		break;
-
 struct dopt display_options;
 
-/*
- * Display an object in a c-like format
- *
- * o:	    object to be displayed
- * depth:   current indentation depth
- * newline: is this the begining of a new line?
- * prefix:  prefix to be printed at the begining of each line
- */
-static pp_t _print_tree(obj_t *o, int depth, bool newline, const char *prefix)
+static void print_prefix(obj_t *o, int depth, bool newline,
+			 const char *prefix, FILE *f)
 {
-	pp_t ret = {NULL, NULL};
-	char *margin;
-
-	/* silence coverity on write-only variable */
-	(void)ret;
-
 	if (!o)
-		fail("NULL pointer in _print_tree\n");
-	debug("_print_tree(): %s\n", typetostr(o));
+		fail("NULL pointer in print_prefix\n");
+	debug("print_prefix(): %s\n", typetostr(o));
+
+	if (newline)
+		print_line_margin(o, depth, prefix, f);
 
 	switch (o->type) {
-	BASIC_CASE(reffile);
-	BASIC_CASE(constant);
-	BASIC_CASE(base);
-	BASIC_CASE(typedef);
-	BASIC_CASE(qualifier);
-	BASIC_CASE(func);
-	BASIC_CASE(array);
-	BASIC_CASE(ptr);
-	BASIC_CASE(assembly);
-	BASIC_CASE(weak);
+	case __type_reffile:
+		print_reffile(o, f);
+		break;
+	case __type_constant:
+		fprintf(f, "%s = %li", o->name, (long)o->constant);
+		break;
+	case __type_base:
+		fprintf(f, "%s ", o->base_type);
+		break;
+	case __type_typedef:
+		fputs("typedef ", f);
+		print_ptr_child(o, depth, prefix, f);
+		print_str(o->name, f);
+		break;
+	case __type_qualifier:
+		if (o->base_type)
+			fprintf(f, "%s ", o->base_type);
+		print_ptr_child(o, depth, prefix, f);
+		break;
+	case __type_func:
+	case __type_array:
+		print_ptr_child(o, depth, prefix, f);
+		break;
+	case __type_ptr:
+		print_ptr_child(o, depth, prefix, f);
+		fputs(is_paren_needed(o) ? "(*" : "*", f);
+		break;
+	case __type_assembly:
+		fputs("assembly ", f);
+		print_str(o->name, f);
+		break;
+	case __type_weak:
+		fputs("weak ", f);
+		print_str(o->name, f);
+		fputs(" -> ", f);
+		print_str(o->link, f);
+		break;
 	case __type_var:
 	case __type_struct_member:
-		ret = print_varlike(o, depth, prefix);
+		print_ptr_child(o, depth, prefix, f);
+		print_varlike(o, f);
 		break;
 	case __type_struct:
 	case __type_union:
 	case __type_enum:
-		ret = print_structlike(o, depth, prefix);
+		print_structlike(o, depth, prefix, f);
 		break;
 	default:
 		fail("WIP: doesn't handle %s\n", typetostr(o));
 	}
+}
 
-	if (!newline)
-		return ret;
-
-	if (o->type == __type_struct_member && !display_options.no_offset) {
-		char *offstr;
-		if (is_bitfield(o))
-			safe_asprintf(&offstr, "0x%lx:%2i-%-2i ",
-				      o->offset, o->first_bit, o->last_bit);
-		else
-			safe_asprintf(&offstr, "0x%lx ", o->offset);
-		margin = print_margin_offset(prefix, offstr, depth);
-		free(offstr);
-	} else
-		margin = print_margin(prefix, depth);
-
-	prefix_str_free(&ret.prefix, margin);
-	return ret;
+static void print_postfix(obj_t *o, int depth, const char *prefix, FILE *f)
+{
+	switch (o->type) {
+	case __type_func:
+		/* the postfix of the return type is not printed */
+		print_func_args(o, depth, prefix, f);
+		break;
+	case __type_array:
+		fprintf(f, "[%lu]", o->constant);
+		print_postfix(o->ptr, depth, prefix, f);
+		break;
+	case __type_ptr:
+		if (is_paren_needed(o))
+			fputc(')', f);
+		print_postfix(o->ptr, depth, prefix, f);
+		break;
+	case __type_typedef:
+	case __type_qualifier:
+	case __type_var:
+	case __type_struct_member:
+		print_postfix(o->ptr, depth, prefix, f);
+		break;
+	default:
+		break;
+	}
 }
 
 void obj_print_tree__prefix(obj_t *root, const char *prefix, FILE *stream)
 {
-	pp_t s = _print_tree(root, 0, true, prefix);
-
-	fprintf(stream, "%s%s;\n",
-	       s.prefix ? s.prefix : "",
-	       s.postfix ? s.postfix : "");
-	free_pp(s);
+	print_line(root, 0, prefix, stream);
+	fputs(";\n", stream);
 }
 
 void obj_print_tree(obj_t *root)
@@ -694,22 +542,17 @@ void obj_print_tree(obj_t *root)
 	obj_print_tree__prefix(root, NULL, stdout);
 }
 
-static void fill_parent_rec(obj_t *o, obj_t *parent)
+static int fill_parent_cb(obj_t *o, void *args)
 {
-	obj_list_t *list = NULL;
-
-	o->parent = parent;
-
-	if (o->member_list)
-		list = o->member_list->first;
+	unsigned int i, len = obj_list_len(o->member_list);
 
-	while (list) {
-		fill_parent_rec(list->member, o);
-		list = list->next;
-	}
+	for (i = 0; i < len; i++)
+		o->member_list->member[i]->parent = o;
 
 	if (o->ptr)
-		fill_parent_rec(o->ptr, o);
+		o->ptr->parent = o;
+
+	return CB_CONT;
 }
 
 /*
@@ -717,42 +560,79 @@ static void fill_parent_rec(obj_t *o, obj_t *parent)
  */
 void obj_fill_parent(obj_t *root)
 {
-	fill_parent_rec(root, NULL);
+	root->parent = NULL;
+	obj_walk_tree(root, fill_parent_cb, NULL);
 }
 
-static int walk_list(obj_list_t *list, cb_t cb_pre, cb_t cb_in, cb_t cb_post,
-			void *args, bool ptr_first)
+/*
+ * The tree walk is iterative, so that deep trees don't exhaust the C stack.
+ * Each node being walked has a frame recording how far its walk went.
+ */
+enum walk_state {
+	WALK_PRE,	/* nothing done yet */
+	WALK_FIRST,	/* walking the first subtrees */
+	WALK_IN,	/* first subtrees walked */
+	WALK_SECOND,	/* walking the second subtrees */
+	WALK_POST,	/* second subtrees walked */
+};
+
+struct walk_frame {
+	obj_t *o;
+	enum walk_state state;
+	unsigned int next;	/* next member to walk or 1 if ptr was */
+};
+
+/* Frames kept on the C stack, deeper walks switch to the heap */
+#define WALK_STACK_INLINE 64
+
+struct walk_stack {
+	struct walk_frame *frames;
+	unsigned int count;
+	unsigned int size;
+	struct walk_frame inline_frames[WALK_STACK_INLINE];
+};
+
+static void walk_stack_push(struct walk_stack *st, obj_t *o)
 {
-	int ret = CB_CONT;
+	struct walk_frame *frame;
 
-	while (list) {
-		ret = obj_walk_tree3(list->member, cb_pre, cb_in, cb_post,
-				 args, ptr_first);
-		if (ret == CB_FAIL)
-			return ret;
-		else
-			ret = CB_CONT;
-		list = list->next;
+	if (st->count == st->size) {
+		st->size *= 2;
+		if (st->frames == st->inline_frames) {
+			st->frames = safe_zmalloc(st->size * sizeof(*frame));
+			memcpy(st->frames, st->inline_frames,
+			       sizeof(st->inline_frames));
+		} else {
+			st->frames = safe_realloc(st->frames,
+						  st->size * sizeof(*frame));
+		}
 	}
 
-	return ret;
+	frame = &st->frames[st->count++];
+	frame->o = o;
+	frame->state = WALK_PRE;
+	frame->next = 0;
 }
 
-static int walk_ptr(obj_t *o, cb_t cb_pre, cb_t cb_in, cb_t cb_post,
-			void *args, bool ptr_first)
+/*
+ * Get the next subtree to walk in the members (or ptr) of the frame's node
+ * or NULL if they are all walked.
+ */
+static obj_t *walk_next_child(struct walk_frame *frame, bool ptr)
 {
-	int ret = CB_CONT;
+	obj_t *o = frame->o;
 
-	if (o->ptr) {
-		ret = obj_walk_tree3(o->ptr, cb_pre, cb_in, cb_post,
-				 args, ptr_first);
-		if (ret == CB_FAIL)
-			return ret;
-		else
-			ret = CB_CONT;
+	if (ptr) {
+		if (frame->next > 0 || o->ptr == NULL)
+			return NULL;
+		frame->next = 1;
+		return o->ptr;
 	}
 
-	return ret;
+	if (frame->next >= obj_list_len(o->member_list))
+		return NULL;
+
+	return o->member_list->member[frame->next++];
 }
 
 /*
@@ -764,48 +644,76 @@ static int walk_ptr(obj_t *o, cb_t cb_pre, cb_t cb_in, cb_t cb_post,
  * cp_post:   callback function called between walking the subtrees
  * args:      argument passed to the callbacks
  * ptr_first: whether we walk member_list of ptr first
+ *
+ * A callback returning CB_SKIP stops the walk of the current node's subtree,
+ * CB_FAIL stops the whole walk.
  */
 int obj_walk_tree3(obj_t *o, cb_t cb_pre, cb_t cb_in, cb_t cb_post,
 			void *args, bool ptr_first)
 {
-	obj_list_t *list = NULL;
+	struct walk_stack st;
+	struct walk_frame *frame;
+	obj_t *child;
+	bool done;
 	int ret = CB_CONT;
 
-	if (cb_pre) {
-		ret = cb_pre(o, args);
-		if (ret)
-			return ret;
-	}
-
-	if (o->member_list)
-		list = o->member_list->first;
+	st.frames = st.inline_frames;
+	st.count = 0;
+	st.size = WALK_STACK_INLINE;
+
+	walk_stack_push(&st, o);
+
+	while (st.count > 0) {
+		frame = &st.frames[st.count - 1];
+		ret = CB_CONT;
+		done = false;
+
+		switch (frame->state) {
+		case WALK_PRE:
+			frame->state = WALK_FIRST;
+			if (cb_pre)
+				ret = cb_pre(frame->o, args);
+			break;
+		case WALK_FIRST:
+			child = walk_next_child(frame, ptr_first);
+			if (child) {
+				walk_stack_push(&st, child);
+				continue;
+			}
+			frame->state = WALK_IN;
+			break;
+		case WALK_IN:
+			frame->state = WALK_SECOND;
+			frame->next = 0;
+			if (cb_in)
+				ret = cb_in(frame->o, args);
+			break;
+		case WALK_SECOND:
+			child = walk_next_child(frame, !ptr_first);
+			if (child) {
+				walk_stack_push(&st, child);
+				continue;
+			}
+			frame->state = WALK_POST;
+			break;
+		case WALK_POST:
+			if (cb_post)
+				ret = cb_post(frame->o, args);
+			done = true;
+			break;
+		}
 
+		if (ret == CB_CONT && !done)
+			continue;
 
-	if (ptr_first)
-		ret = walk_ptr(o, cb_pre, cb_in, cb_post, args, ptr_first);
-	else
-		ret = walk_list(list, cb_pre, cb_in, cb_post, args, ptr_first);
-	if (ret == CB_FAIL)
-		return ret;
-
-	if (cb_in) {
-		ret = cb_in(o, args);
-		if (ret)
-			return ret;
+		/* done with this node, a failure stops the whole walk */
+		st.count--;
+		if (ret == CB_FAIL)
+			break;
 	}
 
-	if (ptr_first)
-		ret = walk_list(list, cb_pre, cb_in, cb_post, args, ptr_first);
-	else
-		ret = walk_ptr(o, cb_pre, cb_in, cb_post, args, ptr_first);
-	if (ret == CB_FAIL)
-		return ret;
-
-	if (cb_post) {
-		ret = cb_post(o, args);
-		if (ret)
-			return ret;
-	}
+	if (st.frames != st.inline_frames)
+		free(st.frames);
 
 	return ret;
 }
@@ -905,7 +813,6 @@ static int hide_kabi_cb(obj_t *o, void *args)
 {
 	obj_t *kabi_struct, *new, *old, *parent = o->parent, *keeper;
 	obj_list_head_t *lh;
-	obj_list_t *l;
 	bool show_new_field = (bool) args;
 
 	if (o->name) {
@@ -922,9 +829,8 @@ static int hide_kabi_cb(obj_t *o, void *args)
 
 	/* Hide RH_KABI_REPLACE */
 	if ((o->type != __type_union) || o->name ||
-	    !(lh = o->member_list) || obj_list_empty(lh) ||
-	    !(l = lh->first) || !(new = l->member) ||
-	    !(l = l->next) || !(kabi_struct = l->member) ||
+	    !(lh = o->member_list) || obj_list_len(lh) < 2 ||
+	    !(new = lh->member[0]) || !(kabi_struct = lh->member[1]) ||
 	    (kabi_struct->type != __type_var) ||
 	    !kabi_struct->name ||
 	    strncmp(kabi_struct->name, RH_KABI_HIDE, RH_KABI_HIDE_LEN))
@@ -932,7 +838,7 @@ static int hide_kabi_cb(obj_t *o, void *args)
 
 	if (!kabi_struct->ptr || kabi_struct->ptr->type != __type_struct ||
 	    !(lh = kabi_struct->ptr->member_list) || obj_list_empty(lh) ||
-	    !(l = lh->first) || !(old = l->member))
+	    !(old = lh->member[0]))
 		fail("Unexpeted rh_kabi_hide struct format\n");
 
 	/*
@@ -984,7 +890,7 @@ static int hide_kabi_cb(obj_t *o, void *args)
 	parent->ptr = keeper->ptr;
 	parent->ptr->parent = parent;
 	_obj_free(o, keeper);
-	free(keeper);
+	obj_dealloc(keeper);
 
 	return CB_SKIP;
 }
@@ -1054,11 +960,12 @@ static obj_t *obj_copy(obj_t *o1)
 {
 	obj_t *o;
 
-	o = safe_zmalloc(sizeof(*o));
+	o = obj_alloc();
 	*o = *o1;
 
 	o->ptr = NULL;
 	o->member_list = NULL;
+	o->shared = 0;
 
 	if (o1->type == __type_reffile && o1->depend_rec_node)
 		o->depend_rec_node = list_node_add(o1->depend_rec_node, o);
@@ -1073,18 +980,17 @@ static obj_list_head_t *obj_members_merge(obj_list_head_t *list1,
 					  unsigned int flags)
 {
 	obj_list_head_t *res = NULL;
-	obj_list_t *l1;
-	obj_list_t *l2;
+	unsigned int i;
 	obj_t *o;
 
 	if (list1 == NULL || list2 == NULL)
 		return NULL;
 
-	l1 = list1->first;
-	l2 = list2->first;
+	if (list1->len != list2->len)
+		return NULL;
 
-	while (l1 && l2) {
-		o = obj_merge(l1->member, l2->member, flags);
+	for (i = 0; i < list1->len; i++) {
+		o = obj_merge(list1->member[i], list2->member[i], flags);
 		if (o == NULL)
 			goto cleanup;
 
@@ -1092,13 +998,7 @@ static obj_list_head_t *obj_members_merge(obj_list_head_t *list1,
 			res = obj_list_head_new(o);
 		else
 			obj_list_add(res, o);
-
-		l1 = l1->next;
-		l2 = l2->next;
-	};
-
-	if (l1 || l2)
-		goto cleanup;
+	}
 
 	return res;
 
@@ -1182,143 +1082,438 @@ no_merge:
 	return NULL;
 }
 
-static void dump_reffile(obj_t *o, FILE *f)
+static bool obj_members_can_merge(obj_list_head_t *list1,
+				  obj_list_head_t *list2,
+				  unsigned int flags)
 {
-	int version = record_get_version(o->ref_record);
+	unsigned int i;
+
+	if (list1 == NULL || list2 == NULL)
+		return false;
+
+	if (list1->len != list2->len)
+		return false;
+
+	/* obj_members_merge() of empty lists gives no list at all */
+	if (list1->len == 0)
+		return false;
+
+	for (i = 0; i < list1->len; i++) {
+		if (!obj_can_merge(list1->member[i], list2->member[i], flags))
+			return false;
+	}
 
-	fprintf(f, "@\"%s", record_get_key(o->ref_record));
-	if (version > 0)
-		fprintf(f, "-%i", version);
-	fprintf(f, ".txt\"\n");
+	return true;
 }
 
-static void _dump_members(obj_t *o, FILE *f, void (*dumper)(obj_t *, FILE *))
+/*
+ * Check if obj_merge() of o1 and o2 would succeed, without building
+ * the merged tree.
+ */
+bool obj_can_merge(obj_t *o1, obj_t *o2, unsigned int flags)
 {
-	obj_list_head_t *l = o->member_list;
-	obj_list_t *list;
+	if (o1 == NULL || o2 == NULL)
+		return false;
 
-	if (l == NULL)
+	if (!obj_can_merge_two_lines(o1, o2, flags))
+		return false;
+
+	if (o1->ptr && !obj_can_merge(o1->ptr, o2->ptr, flags))
+		return false;
+
+	if (o1->member_list &&
+	    !obj_members_can_merge(o1->member_list, o2->member_list, flags))
+		return false;
+
+	return true;
+}
+
+/*
+ * Replace the node o1 by a copy of o2, keeping o1 at its place in
+ * the tree.
+ */
+static void obj_replace_node(obj_t *o1, obj_t *o2)
+{
+	obj_t *parent = o1->parent;
+
+	if (o1->type == __type_reffile && o1->depend_rec_node)
+		list_del(o1->depend_rec_node);
+
+	*o1 = *o2;
+	o1->parent = parent;
+	o1->ptr = NULL;
+	o1->member_list = NULL;
+
+	if (o2->type == __type_reffile && o2->depend_rec_node)
+		o1->depend_rec_node = list_node_add(o2->depend_rec_node, o1);
+}
+
+/*
+ * Merge o2 into o1
+ *
+ * The resulting o1 is the tree obj_merge() would have returned, but no
+ * node is allocated and the parent pointers stay valid, since only the
+ * declarations of o1 get replaced. The merge must have been checked
+ * with obj_can_merge() first.
+ */
+void obj_merge_in_place(obj_t *o1, obj_t *o2)
+{
+	unsigned int i;
+
+	if (obj_is_declaration(o1)) {
+		obj_replace_node(o1, o2);
+		return;
+	}
+
+	/* shared subtrees have no reference file, thus no declaration */
+	if (o1->shared)
 		return;
 
-	list = l->first;
+	if (o1->ptr)
+		obj_merge_in_place(o1->ptr, o2->ptr);
+
+	for (i = 0; i < obj_list_len(o1->member_list); i++)
+		obj_merge_in_place(o1->member_list->member[i],
+				   o2->member_list->member[i]);
+}
+
+/*
+ * Hash-consing of obj subtrees
+ *
+ * obj_hashcons() turns a finished tree into a DAG in which structurally
+ * identical subtrees, from any tree passed to it, are a single node. Such
+ * shared nodes are immutable and owned by the cons table, which counts the
+ * references to them: obj_free() of a shared node only drops a reference.
+ * Their parent field is meaningless.
+ *
+ * Subtrees containing a reference file are never shared, since reffile
+ * nodes are linked to the dependents of their record and get replaced when
+ * records are merged.
+ */
+#define OBJ_CONS_SIZE 4096
+
+struct obj_cons_key {
+	obj_types type;
+	unsigned char is_bitfield, first_bit, last_bit, has_members;
+	const char *name;
+	const char *base_type;
+	unsigned alignment;
+	unsigned int byte_size;
+	obj_t *ptr;
+	unsigned long constant;
+	/* followed by the member pointers */
+};
+
+struct obj_cons {
+	obj_t *obj;
+	unsigned int refcount;
+	size_t keylen;
+	char key[];
+};
+
+static struct hash *obj_cons_table;
+
+/* Allocate a cons entry with the key of o, whose children are shared */
+static struct obj_cons *obj_cons_new(obj_t *o)
+{
+	struct obj_cons *cons;
+	struct obj_cons_key *key;
+	unsigned int count = obj_list_len(o->member_list);
+
+	cons = safe_zmalloc(sizeof(*cons) + sizeof(*key) +
+			    count * sizeof(obj_t *));
+	cons->obj = o;
+	cons->keylen = sizeof(*key) + count * sizeof(obj_t *);
+
+	key = (struct obj_cons_key *)cons->key;
+	key->type = o->type;
+	key->is_bitfield = o->is_bitfield;
+	key->first_bit = o->first_bit;
+	key->last_bit = o->last_bit;
+	key->has_members = o->member_list != NULL;
+	key->name = o->name;
+	key->base_type = o->base_type;
+	key->alignment = o->alignment;
+	key->byte_size = o->byte_size;
+	key->ptr = o->ptr;
+	key->constant = o->constant;
+
+	if (count)
+		memcpy(key + 1, o->member_list->member,
+		       count * sizeof(obj_t *));
+
+	return cons;
+}
+
+/*
+ * Drop a reference to the shared node o
+ *
+ * Returns true if it was the last one, the node is then not shared anymore
+ * and must be freed.
+ */
+static bool obj_cons_put(obj_t *o)
+{
+	struct obj_cons *key = obj_cons_new(o);
+	struct obj_cons *cons;
+
+	cons = hash_find_bin(obj_cons_table, key->key, key->keylen);
+	free(key);
+	if (cons == NULL)
+		fail("Shared node not found\n");
+
+	if (--cons->refcount > 0)
+		return false;
+
+	hash_del_bin(obj_cons_table, cons->key, cons->keylen);
+	o->shared = 0;
+
+	return true;
+}
+
+static obj_t *obj_hashcons_rec(obj_t *o, bool *shareable)
+{
+	struct obj_cons *cons;
+	struct obj_cons *found;
+	unsigned int i;
+	bool child_shareable;
+
+	*shareable = true;
+
+	if (o->shared)
+		return o;
+
+	if (o->ptr) {
+		o->ptr = obj_hashcons_rec(o->ptr, &child_shareable);
+		*shareable = child_shareable;
+	}
+
+	for (i = 0; i < obj_list_len(o->member_list); i++) {
+		obj_t **member = &o->member_list->member[i];
+
+		*member = obj_hashcons_rec(*member, &child_shareable);
+		*shareable = *shareable && child_shareable;
+	}
+
+	switch (o->type) {
+	case __type_reffile:
+	case __type_assembly:
+	case __type_weak:
+		*shareable = false;
+		break;
+	default:
+		break;
+	}
+
+	if (!*shareable)
+		return o;
+
+	cons = obj_cons_new(o);
+	found = hash_find_bin(obj_cons_table, cons->key, cons->keylen);
+	if (found != NULL) {
+		free(cons);
+		found->refcount++;
+		/* drops the references o holds on its children */
+		obj_free(o);
+		return found->obj;
+	}
+
+	cons->refcount = 1;
+	o->shared = 1;
+	o->parent = NULL;
+	hash_add_bin(obj_cons_table, cons->key, cons->keylen, cons);
+
+	return o;
+}
+
+/*
+ * Share the subtrees of root with the trees already hash-consed
+ *
+ * Returns the new root, which is root itself unless the whole tree could
+ * be shared. No node of the tree may be modified afterwards, except for
+ * the reference files and their ancestors.
+ */
+obj_t *obj_hashcons(obj_t *root)
+{
+	bool shareable;
+
+	if (root == NULL)
+		return NULL;
+
+	if (obj_cons_table == NULL) {
+		obj_cons_table = hash_new(OBJ_CONS_SIZE, free);
+		if (obj_cons_table == NULL)
+			fail("Cannot create hash");
+	}
+
+	return obj_hashcons_rec(root, &shareable);
+}
+
+static void dump_reffile(obj_t *o, struct buffer *b)
+{
+	int version = record_get_version(o->ref_record);
 
-	while (list) {
-		dumper(list->member, f);
-		list = list->next;
+	buffer_put(b, "@\"", 2);
+	buffer_puts(b, record_get_key(o->ref_record));
+	if (version > 0) {
+		buffer_putc(b, '-');
+		buffer_put_int(b, version);
 	}
+	buffer_put(b, ".txt\"\n", 6);
+}
+
+static void _dump_members(obj_t *o, struct buffer *b,
+			  void (*dumper)(obj_t *, struct buffer *))
+{
+	unsigned int i;
+
+	for (i = 0; i < obj_list_len(o->member_list); i++)
+		dumper(o->member_list->member[i], b);
+}
+
+static void dump_arg(obj_t *o, struct buffer *b)
+{
+	buffer_puts(b, o->name);
+	buffer_putc(b, ' ');
+	obj_dump(o->ptr, b);
 }
 
-static void dump_arg(obj_t *o, FILE *f)
+static void dump_members(obj_t *o, struct buffer *b)
 {
-	fprintf(f, "%s ", o->name);
-	obj_dump(o->ptr, f);
+	_dump_members(o, b, obj_dump);
 }
 
-static void dump_members(obj_t *o, FILE *f)
+static void dump_args(obj_t *o, struct buffer *b)
 {
-	_dump_members(o, f, obj_dump);
+	_dump_members(o, b, dump_arg);
 }
 
-static void dump_args(obj_t *o, FILE *f)
+/* Dump "<keyword> <name><open>\n" */
+static void dump_head(obj_t *o, struct buffer *b, const char *keyword,
+		      const char *open)
 {
-	_dump_members(o, f, dump_arg);
+	buffer_puts(b, keyword);
+	buffer_putc(b, ' ');
+	buffer_puts(b, o->name);
+	buffer_puts(b, open);
+	buffer_putc(b, '\n');
 }
 
-static void dump_struct(obj_t *o, FILE *f)
+static void dump_struct(obj_t *o, struct buffer *b)
 {
-	fprintf(f, "struct %s {\n", o->name);
-	dump_members(o, f);
-	fprintf(f, "}\n");
+	dump_head(o, b, "struct", " {");
+	dump_members(o, b);
+	buffer_put(b, "}\n", 2);
 }
-static void dump_union(obj_t *o, FILE *f)
+static void dump_union(obj_t *o, struct buffer *b)
 {
-	fprintf(f, "union %s {\n", o->name);
-	dump_args(o, f);
-	fprintf(f, "}\n");
+	dump_head(o, b, "union", " {");
+	dump_args(o, b);
+	buffer_put(b, "}\n", 2);
 }
 
-static void dump_enum(obj_t *o, FILE *f)
+static void dump_enum(obj_t *o, struct buffer *b)
 {
-	fprintf(f, "enum %s {\n", o->name);
-	dump_members(o, f);
-	fprintf(f, "}\n");
+	dump_head(o, b, "enum", " {");
+	dump_members(o, b);
+	buffer_put(b, "}\n", 2);
 }
 
-static void dump_func(obj_t *o, FILE *f)
+static void dump_func(obj_t *o, struct buffer *b)
 {
-	fprintf(f, "func %s (\n", o->name);
-	dump_args(o, f);
-	fprintf(f, ")\n");
+	dump_head(o, b, "func", " (");
+	dump_args(o, b);
+	buffer_put(b, ")\n", 2);
 
-	obj_dump(o->ptr, f);
+	obj_dump(o->ptr, b);
 }
 
-static void dump_ptr(obj_t *o, FILE *f)
+static void dump_ptr(obj_t *o, struct buffer *b)
 {
-	fprintf(f, "* ");
-	obj_dump(o->ptr, f);
+	buffer_put(b, "* ", 2);
+	obj_dump(o->ptr, b);
 }
 
-static void dump_typedef(obj_t *o, FILE *f)
+static void dump_typedef(obj_t *o, struct buffer *b)
 {
-	fprintf(f, "typedef %s\n", o->name);
-	obj_dump(o->ptr, f);
+	dump_head(o, b, "typedef", "");
+	obj_dump(o->ptr, b);
 }
 
-static void dump_array(obj_t *o, FILE *f)
+static void dump_array(obj_t *o, struct buffer *b)
 {
-	fprintf(f, "[%lu]", o->index);
-	obj_dump(o->ptr, f);
+	buffer_putc(b, '[');
+	buffer_put_uint(b, o->index);
+	buffer_putc(b, ']');
+	obj_dump(o->ptr, b);
 }
 
-static void dump_var(obj_t *o, FILE *f)
+static void dump_var(obj_t *o, struct buffer *b)
 {
-	fprintf(f, "var %s ", o->name);
-	obj_dump(o->ptr, f);
+	buffer_put(b, "var ", 4);
+	buffer_puts(b, o->name);
+	buffer_putc(b, ' ');
+	obj_dump(o->ptr, b);
 }
 
-static void dump_struct_member(obj_t *o, FILE *f)
+static void dump_struct_member(obj_t *o, struct buffer *b)
 {
-	fprintf(f, "0x%lx", o->offset);
-	if (o->is_bitfield)
-		fprintf(f, ":%d-%d", o->first_bit, o->last_bit);
+	buffer_put(b, "0x", 2);
+	buffer_put_hex(b, o->offset);
+	if (o->is_bitfield) {
+		buffer_putc(b, ':');
+		buffer_put_int(b, o->first_bit);
+		buffer_putc(b, '-');
+		buffer_put_int(b, o->last_bit);
+	}
 
-	if (o->alignment != 0)
-		fprintf(f, " %u", o->alignment);
+	if (o->alignment != 0) {
+		buffer_putc(b, ' ');
+		buffer_put_uint(b, o->alignment);
+	}
 
-	fprintf(f, " %s ", o->name);
-	obj_dump(o->ptr, f);
+	buffer_putc(b, ' ');
+	buffer_puts(b, o->name);
+	buffer_putc(b, ' ');
+	obj_dump(o->ptr, b);
 }
 
-static void dump_qualifier(obj_t *o, FILE *f)
+static void dump_qualifier(obj_t *o, struct buffer *b)
 {
-	fprintf(f, "%s ", o->base_type);
-	obj_dump(o->ptr, f);
+	buffer_puts(b, o->base_type);
+	buffer_putc(b, ' ');
+	obj_dump(o->ptr, b);
 }
 
-static void dump_base(obj_t *o, FILE *f)
+static void dump_base(obj_t *o, struct buffer *b)
 {
 	const char *type = o->base_type;
 
 	/* variable args (...) is a special base case */
-	if (type[0] == '.')
-		fprintf(f, "%s\n", o->base_type);
-	else
-		fprintf(f, "\"%s\"\n", o->base_type);
+	if (type[0] == '.') {
+		buffer_puts(b, type);
+		buffer_putc(b, '\n');
+	} else {
+		buffer_putc(b, '"');
+		buffer_puts(b, type);
+		buffer_put(b, "\"\n", 2);
+	}
 }
 
-static void dump_constant(obj_t *o, FILE *f)
+static void dump_constant(obj_t *o, struct buffer *b)
 {
-	fprintf(f, "%s = 0x%lx\n", o->name, o->constant);
+	buffer_puts(b, o->name);
+	buffer_put(b, " = 0x", 5);
+	buffer_put_hex(b, o->constant);
+	buffer_putc(b, '\n');
 }
 
-static void dump_fail(obj_t *o, FILE *f)
+static void dump_fail(obj_t *o, struct buffer *b)
 {
 	fail("Dump call for this type unsupported!\n");
 }
 
 struct dumper {
-	void (*dumper)(obj_t *o, FILE *f);
+	void (*dumper)(obj_t *o, struct buffer *b);
 };
 
 static struct dumper dumpers[] = {
@@ -1339,7 +1534,7 @@ static struct dumper dumpers[] = {
 	[__type_weak].dumper = dump_fail,
 };
 
-void obj_dump(obj_t *o, FILE *f)
+void obj_dump(obj_t *o, struct buffer *b)
 {
 	if (o == NULL)
 		return;
@@ -1347,15 +1542,14 @@ void obj_dump(obj_t *o, FILE *f)
 	if (o->type >= NR_OBJ_TYPES)
 		fail("Wrong object type %d", o->type);
 
-	dumpers[o->type].dumper(o, f);
+	dumpers[o->type].dumper(o, b);
 }
 
 bool obj_same_declarations(obj_t *o1, obj_t *o2,
-			   struct set *processed)
+			   struct same_decl_cache *cache)
 {
 	const int ignore_versions = true;
-	obj_list_t *list1;
-	obj_list_t *list2;
+	unsigned int i;
 
 	if (o1 == o2)
 		return true;
@@ -1372,35 +1566,24 @@ bool obj_same_declarations(obj_t *o1, obj_t *o2,
 
 	if (o1->type == __type_reffile &&
 	    !record_same_declarations(o1->ref_record, o2->ref_record,
-				      processed)) {
+				      cache)) {
 		return false;
 	}
 
 	if (o1->ptr &&
-	    !obj_same_declarations(o1->ptr, o2->ptr, processed)) {
+	    !obj_same_declarations(o1->ptr, o2->ptr, cache)) {
 		return false;
 	}
 
 	if (o1->member_list) {
-		list1 = o1->member_list->first;
-		list2 = o2->member_list->first;
-
-		while (list1) {
-			if (list2 == NULL)
-				return false;
+		if (o1->member_list->len != o2->member_list->len)
+			return false;
 
-			if (!obj_same_declarations(list1->member,
-						   list2->member,
-						   processed))
+		for (i = 0; i < o1->member_list->len; i++) {
+			if (!obj_same_declarations(o1->member_list->member[i],
+						   o2->member_list->member[i],
+						   cache))
 				return false;
-
-			list1 = list1->next;
-			list2 = list2->next;
-		}
-
-		if (list1 != list2) {
-			/* different member_list lengths */
-			return false;
 		}
 	}
 
@@ -34,7 +34,8 @@
 #define debug(args...)
 #endif
 
-struct set;
+struct same_decl_cache;
+struct buffer;
 
 enum merge_flag {
 	MERGE_DEFAULT = 0,
@@ -63,16 +64,25 @@ typedef enum {
 } obj_types;
 
 struct obj;
-typedef struct obj_list {
-	struct obj *member;
-	struct obj_list *next;
-} obj_list_t;
 
+/* Growable array of the members of a node */
 typedef struct obj_list_head {
-	obj_list_t *first, *last;
+	struct obj **member;
+	unsigned int len;	/* number of members */
+	unsigned int size;	/* allocated size of member */
 	struct obj *object;
 } obj_list_head_t;
 
+static inline unsigned int obj_list_len(obj_list_head_t *head)
+{
+	return head ? head->len : 0;
+}
+
+static inline bool obj_list_empty(obj_list_head_t *head)
+{
+	return obj_list_len(head) == 0;
+}
+
 /*
  * Structure representing symbols. Several field are overloaded.
  *
@@ -99,13 +109,14 @@ typedef struct obj_list_head {
  * offset:	(var) offset of a struct member
  * depend_rec_node:	(reffile) node from dependents field of record where
  *			this obj references.
+ * shared:	the node is shared by several trees, see obj_hashcons()
  *
  * Note the dual parent/child relationship with the n-ary member_list and the
  * the unary ptr. Only functions uses both.
  */
 typedef struct obj {
 	obj_types type;
-	unsigned char is_bitfield, first_bit, last_bit;
+	unsigned char is_bitfield, first_bit, last_bit, shared;
 	union {
 		const char *name;
 		struct record *ref_record;
@@ -208,7 +219,6 @@ typedef enum {
 
 typedef int cb_t(obj_t *o, void *args);
 
-obj_list_t *obj_list_new(obj_t *obj);
 obj_list_head_t *obj_list_head_new(obj_t *obj);
 void obj_list_add(obj_list_head_t *head, obj_t *obj);
 void obj_free(obj_t *o);
@@ -240,12 +250,16 @@ int obj_walk_tree3(obj_t *o, cb_t cb_pre, cb_t cb_in, cb_t cb_post,
 
 int obj_hide_kabi(obj_t *root, bool show_new_field);
 
-obj_t *obj_parse(FILE *file, char *fn);
+obj_t *obj_parse(const char *data, size_t len, char *fn);
 obj_t *obj_merge(obj_t *o1, obj_t *o2, unsigned int flags);
-void obj_dump(obj_t *o, FILE *f);
+bool obj_can_merge(obj_t *o1, obj_t *o2, unsigned int flags);
+void obj_merge_in_place(obj_t *o1, obj_t *o2);
+obj_t *obj_hashcons(obj_t *root);
+void obj_dump(obj_t *o, struct buffer *b);
 
 bool obj_eq(obj_t *o1, obj_t *o2, bool ignore_versions);
 
-bool obj_same_declarations(obj_t *o1, obj_t *o2, struct set *processed);
+bool obj_same_declarations(obj_t *o1, obj_t *o2,
+			   struct same_decl_cache *cache);
 
 #endif
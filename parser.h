@@ -22,12 +22,6 @@
 
 #include "objects.h"
 
-/* Prevents warning: ‘input’ defined but not used  */
-#define YY_NO_INPUT
-
-/* Why can't it get it from stdio.h? */
-int fileno(FILE *stream);
-
+void lexer_start(const char *data, size_t len);
 int yylex();
 int yyerror(obj_t **root, char *s);
-extern FILE *yyin;
@@ -0,0 +1,110 @@
+/* A Bison parser, made by GNU Bison 3.8.2.  */
+
+/* Bison interface for Yacc-like parsers in C
+
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* As a special exception, you may create a larger work that contains
+   part or all of the Bison parser skeleton and distribute that work
+   under terms of your choice, so long as that work isn't itself a
+   parser generator using the skeleton or a modified version thereof
+   as a parser skeleton.  Alternatively, if you modify or redistribute
+   the parser skeleton itself, you may (at your option) remove this
+   special exception, which will cause the skeleton and the resulting
+   Bison output files to be licensed under the GNU General Public
+   License without this special exception.
+
+   This special exception was added by the Free Software Foundation in
+   version 2.2 of Bison.  */
+
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+#ifndef YY_YY_PARSER_TAB_H_INCLUDED
+# define YY_YY_PARSER_TAB_H_INCLUDED
+/* Debug traces.  */
+#ifndef YYDEBUG
+# define YYDEBUG 1
+#endif
+#if YYDEBUG
+extern int yydebug;
+#endif
+
+/* Token kinds.  */
+#ifndef YYTOKENTYPE
+# define YYTOKENTYPE
+  enum yytokentype
+  {
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    IDENTIFIER = 258,              /* IDENTIFIER  */
+    STRING = 259,                  /* STRING  */
+    SRCFILE = 260,                 /* SRCFILE  */
+    CONSTANT = 261,                /* CONSTANT  */
+    NEWLINE = 262,                 /* NEWLINE  */
+    TYPEDEF = 263,                 /* TYPEDEF  */
+    CONST = 264,                   /* CONST  */
+    VOLATILE = 265,                /* VOLATILE  */
+    STRUCT = 266,                  /* STRUCT  */
+    UNION = 267,                   /* UNION  */
+    ENUM = 268,                    /* ENUM  */
+    ELLIPSIS = 269,                /* ELLIPSIS  */
+    VERSION_KW = 270,              /* VERSION_KW  */
+    CU_KW = 271,                   /* CU_KW  */
+    FILE_KW = 272,                 /* FILE_KW  */
+    STACK_KW = 273,                /* STACK_KW  */
+    SYMBOL_KW_NL = 274,            /* SYMBOL_KW_NL  */
+    ARROW = 275,                   /* ARROW  */
+    UNKNOWN_FIELD = 276            /* UNKNOWN_FIELD  */
+  };
+  typedef enum yytokentype yytoken_kind_t;
+#endif
+
+/* Value type.  */
+#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
+union YYSTYPE
+{
+#line 40 "parser.y"
+
+	int i;
+	unsigned int ui;
+	long l;
+	unsigned long ul;
+	void *ptr;
+	char *str;	/* kept by the lexer, see global_string_get_n() */
+	obj_t *obj;
+	obj_list_head_t *list;
+
+#line 96 "parser.tab.h"
+
+};
+typedef union YYSTYPE YYSTYPE;
+# define YYSTYPE_IS_TRIVIAL 1
+# define YYSTYPE_IS_DECLARED 1
+#endif
+
+
+extern YYSTYPE yylval;
+
+
+int yyparse (obj_t **root);
+
+
+#endif /* !YY_YY_PARSER_TAB_H_INCLUDED  */
@@ -27,12 +27,11 @@
 	YYABORT;				\
 }
 
-#define check_and_free_keyword(identifier, expected)			\
+#define check_keyword(identifier, expected)				\
 {									\
 	if (strcmp(identifier, expected))				\
 		abort("Wrong keyword: %s expected, %s received\n",	\
 		      expected, identifier);				\
-	free(identifier);						\
 }
 
 
@@ -44,7 +43,7 @@
 	long l;
 	unsigned long ul;
 	void *ptr;
-	char *str;
+	char *str;	/* kept by the lexer, see global_string_get_n() */
 	obj_t *obj;
 	obj_list_head_t *list;
 }
@@ -104,16 +103,10 @@ header_field:
 
 cu_field:
 	CU_KW STRING NEWLINE
-	{
-	    free($STRING);
-	}
 	;
 
 source_file_field:
 	FILE_KW SRCFILE ':' CONSTANT NEWLINE
-	{
-	    free($SRCFILE);
-	}
 	;
 
 stack_field:
@@ -127,9 +120,6 @@ stack_list:
 
 stack_elt:
 	ARROW STRING
-	{
-		free($STRING);
-	}
 	;
 
 symbol:
@@ -157,15 +147,15 @@ symbol:
 alignment:
         IDENTIFIER CONSTANT NEWLINE
 	{
-		check_and_free_keyword($IDENTIFIER, "Alignment");
+		check_keyword($IDENTIFIER, "Alignment");
 		$$ = $CONSTANT;
 	}
 
 byte_size:
         IDENTIFIER IDENTIFIER CONSTANT NEWLINE
 	{
-		check_and_free_keyword($1, "Byte");
-		check_and_free_keyword($2, "size");
+		check_keyword($1, "Byte");
+		check_keyword($2, "size");
 		$$ = $CONSTANT;
 	}
 
@@ -191,7 +181,7 @@ declaration_typedef:
 declaration_var:
 	IDENTIFIER IDENTIFIER type
 	{
-	    check_and_free_keyword($1, "var");
+	    check_keyword($1, "var");
 	    $$ = obj_var_new_add($2, $type);
 	}
 	;
@@ -314,7 +304,7 @@ enum_elt:
 func_type:
 	IDENTIFIER IDENTIFIER '(' NEWLINE arg_list ')' NEWLINE type
 	{
-	    check_and_free_keyword($1, "func");
+	    check_keyword($1, "func");
 	    $$ = obj_func_new_add($2, $type);
 	    $$->member_list = $arg_list;
 	    if ($arg_list)
@@ -322,7 +312,7 @@ func_type:
 	}
 	| IDENTIFIER reference_file /* protype define as typedef */
 	{
-	    check_and_free_keyword($IDENTIFIER, "func");
+	    check_keyword($IDENTIFIER, "func");
 	    $$ = obj_func_new_add(NULL, $reference_file);
 	}
 	;
@@ -397,12 +387,12 @@ type_qualifier:
 	CONST
 	{
 	    debug("Qualifier: const\n");
-	    $$ = strdup("const");
+	    $$ = (char *)global_string_get_copy("const");
 	}
 	| VOLATILE
 	{
 	    debug("Qualifier: volatile\n");
-	    $$ = strdup("volatile");
+	    $$ = (char *)global_string_get_copy("volatile");
 	}
 	;
 
@@ -425,7 +415,7 @@ reference_file:
 asm_symbol:
 	IDENTIFIER IDENTIFIER
 	{
-		check_and_free_keyword($1, "assembly");
+		check_keyword($1, "assembly");
 		$$ = obj_assembly_new($2);
 	}
 	;
@@ -433,9 +423,9 @@ asm_symbol:
 weak_symbol:
         IDENTIFIER IDENTIFIER ARROW IDENTIFIER
 	{
-		check_and_free_keyword($1, "weak");
+		check_keyword($1, "weak");
 		$$ = obj_weak_new($2);
-		$$->link = $4;
+		$$->link = safe_strdup($4);
 	}
 	;
 
@@ -444,7 +434,8 @@ weak_symbol:
 
 extern void usage(void);
 
-obj_t *obj_parse(FILE *file, char *fn) {
+/* Parse the len bytes of the kabi file fn, read or mapped at data */
+obj_t *obj_parse(const char *data, size_t len, char *fn) {
 	obj_t *root = NULL;
 
 #ifdef DEBUG
@@ -453,7 +444,7 @@ obj_t *obj_parse(FILE *file, char *fn) {
 	yydebug = 0;
 #endif
 
-	yyin = file;
+	lexer_start(data, len);
 	yyparse(&root);
 	if (!root)
 		fail("No object build for file %s\n", fn);
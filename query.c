@@ -0,0 +1,392 @@
+/*
+	Copyright(C) 2017, Red Hat, Inc.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * The query command answers reachability questions on a kabi dump: which
+ * files a symbol or a type depends on, and which exported symbols depend
+ * on a type.
+ *
+ * The references are read from the DEPENDENTS_FILE written by generate, so
+ * that no record needs to be parsed. Dumps without it have all their files
+ * parsed to collect the references.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main.h"
+#include "objects.h"
+#include "utils.h"
+#include "hash.h"
+#include "query.h"
+#include "archive.h"
+#include "manifest.h"
+
+#define QUERY_HASH_SIZE 4096
+
+struct query_edge {
+	unsigned int from;
+	unsigned int to;	/* from references to */
+};
+
+struct query_graph {
+	char *dir;
+	struct archive *ar;
+	char **names;		/* the files, in walk_dir() order */
+	unsigned int count;
+	unsigned int size;
+	struct hash *index;	/* file -> &names[i] */
+	struct query_edge *edges;
+	unsigned int nedges;
+	unsigned int esize;
+	/* successors of file i are adj[first[i]..first[i+1]] */
+	unsigned int *first;
+	unsigned int *adj;
+};
+
+struct query_parse_ctx {
+	struct query_graph *g;
+	unsigned int from;
+};
+
+enum {
+	QUERY_UNSEEN = 0,
+	QUERY_START,	/* matches one of the names */
+	QUERY_REACHED,
+};
+
+struct {
+	bool reverse;
+	bool files;
+} query_config = {false, false};
+
+static void query_usage()
+{
+	printf("Usage:\n"
+	       "\tquery [options] kabi_dir name...\n"
+	       "\nList the kabi files the names depend on. A name is a kabi"
+	       " file,\nan exported symbol or a type (e.g. \"struct foo\").\n"
+	       "\nOptions:\n"
+	       "    -h, --help:\t\tshow this message\n"
+	       "    -r, --reverse:\tlist the exported symbols depending on"
+	       " the names\n"
+	       "    -f, --files:\twith --reverse, list all the kabi files"
+	       " depending\n\t\t\ton the names\n");
+	exit(1);
+}
+
+static void query_add_file(struct query_graph *g, const char *name)
+{
+	if (g->count == g->size) {
+		g->size = g->size ? g->size * 2 : 1024;
+		g->names = safe_realloc(g->names, g->size * sizeof(*g->names));
+	}
+	g->names[g->count++] = safe_strdup(name);
+}
+
+static void query_add_edge(struct query_graph *g, unsigned int from,
+			   unsigned int to)
+{
+	if (g->nedges == g->esize) {
+		g->esize = g->esize ? g->esize * 2 : 1024;
+		g->edges = safe_realloc(g->edges, g->esize * sizeof(*g->edges));
+	}
+	g->edges[g->nedges].from = from;
+	g->edges[g->nedges].to = to;
+	g->nedges++;
+}
+
+static walk_rv_t query_files_cb(char *kabi_path, void *arg)
+{
+	struct query_graph *g = arg;
+	char *filename = kabi_path;
+
+	if (strcmp(basename(kabi_path), MANIFEST_FILE) == 0 ||
+	    strcmp(basename(kabi_path), CHECKSUMS_FILE) == 0 ||
+	    strcmp(basename(kabi_path), DEPENDENTS_FILE) == 0)
+		return WALK_CONT;
+
+	/* If g->dir contains slashes, skip them */
+	if (g->ar == NULL) {
+		filename += strlen(g->dir);
+		while (*filename == '/')
+			filename++;
+	}
+
+	query_add_file(g, filename);
+
+	return WALK_CONT;
+}
+
+static int query_add_ref(obj_t *o, void *args)
+{
+	struct query_parse_ctx *ctx = args;
+	char **to;
+
+	if (o->type != __type_reffile)
+		return CB_CONT;
+
+	/* declarations may not be dumped */
+	to = hash_find(ctx->g->index, o->base_type);
+	if (to != NULL)
+		query_add_edge(ctx->g, ctx->from, to - ctx->g->names);
+
+	return CB_CONT;
+}
+
+static void query_parse_refs(struct query_graph *g)
+{
+	struct query_parse_ctx ctx = { .g = g };
+	struct kabi_data data;
+	obj_t *root;
+	char *path;
+
+	for (ctx.from = 0; ctx.from < g->count; ctx.from++) {
+		if (!kabi_load(g->dir, g->ar, g->names[ctx.from], &data,
+			       &path))
+			fail("Failed to open kABI file: %s\n", path);
+		root = obj_parse(data.data, data.len, path);
+		obj_walk_tree(root, query_add_ref, &ctx);
+		obj_free(root);
+		kabi_unload(&data);
+		free(path);
+	}
+}
+
+/*
+ * Build the reference graph of the dump. The edges go from the referencing
+ * files to the referenced ones, or the other way round if reverse is set.
+ */
+static void query_graph_init(struct query_graph *g, bool reverse)
+{
+	struct manifest *m = manifest_load(g->dir, g->ar);
+	unsigned int i, d;
+
+	if (m != NULL && manifest_has_dependents(m)) {
+		for (i = 0; i < manifest_count(m); i++)
+			query_add_file(g, manifest_name(m, i));
+	} else if (g->ar != NULL) {
+		archive_walk(g->ar, query_files_cb, g);
+	} else {
+		walk_dir(g->dir, false, query_files_cb, g);
+	}
+
+	g->index = hash_new(QUERY_HASH_SIZE, NULL);
+	if (g->index == NULL)
+		fail("Cannot create the file index\n");
+	for (i = 0; i < g->count; i++)
+		hash_add(g->index, g->names[i], &g->names[i]);
+
+	if (m != NULL && manifest_has_dependents(m)) {
+		for (i = 0; i < g->count; i++) {
+			const unsigned int *deps;
+			unsigned int n = manifest_dependents(m, i, &deps);
+
+			for (d = 0; d < n; d++)
+				query_add_edge(g, deps[d], i);
+		}
+	} else {
+		query_parse_refs(g);
+	}
+	manifest_free(m);
+
+	/* count the successors, then place them from the end of each slot */
+	g->first = safe_zmalloc((g->count + 1) * sizeof(*g->first));
+	g->adj = safe_zmalloc((g->nedges + 1) * sizeof(*g->adj));
+	for (i = 0; i < g->nedges; i++)
+		g->first[reverse ? g->edges[i].to : g->edges[i].from]++;
+	for (i = 1; i <= g->count; i++)
+		g->first[i] += g->first[i - 1];
+	for (i = 0; i < g->nedges; i++) {
+		struct query_edge *e = &g->edges[i];
+
+		if (reverse)
+			g->adj[--g->first[e->to]] = e->from;
+		else
+			g->adj[--g->first[e->from]] = e->to;
+	}
+}
+
+static void query_graph_free(struct query_graph *g)
+{
+	unsigned int i;
+
+	for (i = 0; i < g->count; i++)
+		free(g->names[i]);
+	free(g->names);
+	free(g->edges);
+	free(g->first);
+	free(g->adj);
+	hash_free(g->index);
+}
+
+static bool is_type_file(const char *filename)
+{
+	static const char *prefixes[] = {
+		TYPEDEF_FILE, STRUCT_FILE, UNION_FILE, ENUM_FILE,
+	};
+	const char *base = basename((char *)filename);
+	unsigned int i;
+
+	for (i = 0; i < sizeof(prefixes) / sizeof(*prefixes); i++) {
+		if (strncmp(base, prefixes[i], strlen(prefixes[i])) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Does the kabi file match name? The name is either the file itself or
+ * the symbol or type it describes, in which case all its versions match.
+ */
+static bool query_match(const char *filename, const char *name)
+{
+	char *s;
+	bool ret;
+
+	if (strcmp(filename, name) == 0)
+		return true;
+
+	if (is_symbol_file(filename))
+		s = filenametosymbol(filename);
+	else if (is_type_file(filename))
+		s = filenametotype(filename);
+	else
+		return false;
+
+	ret = strcmp(s, name) == 0;
+	free(s);
+
+	return ret;
+}
+
+static void query_print(struct query_graph *g, unsigned char *state)
+{
+	unsigned int i;
+
+	for (i = 0; i < g->count; i++) {
+		char *symbol;
+
+		if (state[i] != QUERY_REACHED)
+			continue;
+
+		if (!query_config.reverse || query_config.files) {
+			printf("%s\n", g->names[i]);
+			continue;
+		}
+
+		if (!is_symbol_file(g->names[i]))
+			continue;
+		symbol = filenametosymbol(g->names[i]);
+		printf("%s\n", symbol);
+		free(symbol);
+	}
+}
+
+/*
+ * Performs the query command
+ */
+int query(int argc, char **argv)
+{
+	struct query_graph g = { NULL };
+	unsigned char *state;
+	unsigned int *queue;
+	unsigned int head = 0, tail = 0, i;
+	int opt, opt_index, err;
+	struct option loptions[] = {
+		{"help", no_argument, 0, 'h'},
+		{"reverse", no_argument, 0, 'r'},
+		{"files", no_argument, 0, 'f'},
+		{0, 0, 0, 0}
+	};
+
+	while ((opt = getopt_long(argc, argv, "hrf",
+				  loptions, &opt_index)) != -1) {
+		switch (opt) {
+		case 'r':
+			query_config.reverse = true;
+			break;
+		case 'f':
+			query_config.files = true;
+			break;
+		case 'h':
+		default:
+			query_usage();
+		}
+	}
+
+	if (argc < optind + 2) {
+		printf("Wrong number of argument\n");
+		query_usage();
+	}
+
+	g.dir = argv[optind++];
+	if (is_archive(g.dir))
+		g.ar = archive_open(g.dir);
+	else if ((err = check_is_directory(g.dir)) != 0)
+		fail("Cannot read '%s': %s\n", g.dir, strerror(err));
+
+	query_graph_init(&g, query_config.reverse);
+
+	state = safe_zmalloc(g.count + 1);
+	queue = safe_zmalloc((g.count + 1) * sizeof(*queue));
+
+	for (; optind < argc; optind++) {
+		bool found = false;
+
+		for (i = 0; i < g.count; i++) {
+			if (!query_match(g.names[i], argv[optind]))
+				continue;
+			found = true;
+			if (state[i] == QUERY_START)
+				continue;
+			state[i] = QUERY_START;
+			queue[tail++] = i;
+		}
+
+		if (!found)
+			fail("No kabi file matches '%s'\n", argv[optind]);
+	}
+
+	while (head < tail) {
+		unsigned int v = queue[head++];
+
+		for (i = g.first[v]; i < g.first[v + 1]; i++) {
+			unsigned int w = g.adj[i];
+
+			if (state[w] != QUERY_UNSEEN)
+				continue;
+			state[w] = QUERY_REACHED;
+			queue[tail++] = w;
+		}
+	}
+
+	query_print(&g, state);
+
+	free(queue);
+	free(state);
+	query_graph_free(&g);
+	if (g.ar != NULL)
+		archive_close(g.ar);
+
+	return 0;
+}
@@ -72,7 +72,7 @@ struct record {
 	obj_t *obj;
 	char *link;
 	void (*free)(struct record *);
-	void (*dump)(struct record *, FILE *);
+	void (*dump)(struct record *, struct buffer *);
 
 	struct list dependents;
 	struct list_node *list_node;
@@ -95,6 +95,6 @@ static inline bool record_is_declaration(struct record *record)
 }
 
 bool record_same_declarations(struct record *r1, struct record *r2,
-			      struct set *processed);
+			      struct same_decl_cache *cache);
 
 #endif /* RECORD_H_ */
@@ -0,0 +1,303 @@
+/*
+	Copyright(C) 2017, Red Hat, Inc.
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Compare server
+ *
+ * serve keeps kabi dumps parsed in memory and runs the compare commands it
+ * gets on a Unix socket: comparing a dump to one of them costs neither a
+ * process start nor their parsing.
+ *
+ * A request is the current directory of the client followed by the
+ * arguments of compare, each of them terminated by '\0', and then an empty
+ * argument. The answer is the output of compare, followed by '\0' and its
+ * exit status in decimal if it did not fail.
+ *
+ * Each request is run by a child process, which shares the parsed dumps
+ * with the server.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "serve.h"
+#include "compare.h"
+#include "buffer.h"
+#include "utils.h"
+
+#define SERVE_READ_SIZE 4096
+
+static void serve_usage(void)
+{
+	printf("Usage:\n"
+	       "\tserve [options] socket kabi_dir...\n"
+	       "\tserve -c socket [--] [compare arguments]\n"
+	       "\nKeep the kabi_dirs parsed and run the compare commands "
+	       "received on socket.\n"
+	       "\nOptions:\n"
+	       "    -h, --help:\t\tshow this message\n"
+	       "    -k, --hide-kabi:\thide changes made by RH_KABI_REPLACE()\n"
+	       "    -n, --hide-kabi-new:\n\t\t\thide the kabi trickery made by"
+	       " RH_KABI_REPLACE, but show the new field\n"
+	       "    -c, --connect socket:\n\t\t\tsend the compare arguments "
+	       "to the server listening on socket\n");
+
+	exit(1);
+}
+
+static int serve_socket(const char *path, struct sockaddr_un *addr)
+{
+	int fd;
+
+	if (strlen(path) >= sizeof(addr->sun_path))
+		fail("Socket path too long: %s\n", path);
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	strcpy(addr->sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		fail("Cannot create socket: %s\n", strerror(errno));
+
+	return fd;
+}
+
+/* Read from fd until the request is complete, return its arguments */
+static char **serve_read_request(int fd, struct buffer *buf, int *argc)
+{
+	int size = 16;
+	char **argv = safe_zmalloc(size * sizeof(*argv));
+	size_t pos = 0;
+
+	*argc = 0;
+	for (;;) {
+		char *end;
+		ssize_t n;
+
+		/* the arguments are split once the request is complete */
+		end = memchr(buf->data + pos, '\0', buf->len - pos);
+		if (end != NULL) {
+			if (end == buf->data + pos)
+				break;
+			pos = end - buf->data + 1;
+			continue;
+		}
+
+		buffer_grow(buf, SERVE_READ_SIZE);
+		n = read(fd, buf->data + buf->len, buf->size - buf->len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			fail("Cannot read the request: %s\n", strerror(errno));
+		}
+		if (n == 0)
+			fail("Incomplete request\n");
+		buf->len += n;
+	}
+
+	for (pos = 0; buf->data[pos] != '\0';
+	     pos += strlen(buf->data + pos) + 1) {
+		if (*argc + 1 >= size) {
+			size *= 2;
+			argv = safe_realloc(argv, size * sizeof(*argv));
+		}
+		argv[(*argc)++] = buf->data + pos;
+	}
+	argv[*argc] = NULL;
+
+	return argv;
+}
+
+/* Run the request of the client on fd, in a child process */
+static void serve_request(int fd)
+{
+	struct buffer buf;
+	char **argv;
+	int argc, ret;
+
+	buffer_init(&buf);
+	argv = serve_read_request(fd, &buf, &argc);
+	if (argc < 1)
+		fail("Empty request\n");
+
+	if (dup2(fd, STDOUT_FILENO) < 0 || dup2(fd, STDERR_FILENO) < 0)
+		fail("Cannot redirect the output: %s\n", strerror(errno));
+	if (chdir(argv[0]) < 0)
+		fail("Cannot change directory to %s: %s\n", argv[0],
+		     strerror(errno));
+
+	/* the directory is done with, compare() expects its name there */
+	argv[0] = "compare";
+	optind = 0;
+	ret = compare(argc, argv);
+
+	fflush(stdout);
+	printf("%c%d", '\0', ret);
+	fflush(stdout);
+	_exit(0);
+}
+
+static void serve_loop(int fd)
+{
+	for (;;) {
+		pid_t pid;
+		int conn;
+
+		conn = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+		if (conn < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			fail("Cannot accept a connection: %s\n",
+			     strerror(errno));
+		}
+
+		/* reap the finished requests */
+		while (waitpid(-1, NULL, WNOHANG) > 0)
+			;
+
+		fflush(stdout);
+		pid = fork();
+		if (pid < 0)
+			fail("Cannot fork: %s\n", strerror(errno));
+		if (pid == 0) {
+			close(fd);
+			serve_request(conn);
+		}
+		close(conn);
+	}
+}
+
+/* Send the compare arguments to the server, print the answer */
+static int serve_client(const char *path, int argc, char **argv)
+{
+	struct sockaddr_un addr;
+	struct buffer buf;
+	char *cwd, *end;
+	size_t len;
+	int fd, i, ret = 1;
+
+	fd = serve_socket(path, &addr);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+		fail("Cannot connect to %s: %s\n", path, strerror(errno));
+
+	cwd = getcwd(NULL, 0);
+	if (cwd == NULL)
+		fail("Cannot get the current directory: %s\n", strerror(errno));
+
+	buffer_init(&buf);
+	buffer_put(&buf, cwd, strlen(cwd) + 1);
+	for (i = 0; i < argc; i++)
+		buffer_put(&buf, argv[i], strlen(argv[i]) + 1);
+	buffer_putc(&buf, '\0');
+	if (buffer_write(&buf, fd) < 0)
+		fail("Cannot send the request: %s\n", strerror(errno));
+	free(cwd);
+
+	buffer_reset(&buf);
+	for (;;) {
+		ssize_t n;
+
+		buffer_grow(&buf, SERVE_READ_SIZE);
+		n = read(fd, buf.data + buf.len, buf.size - buf.len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			fail("Cannot read the answer: %s\n", strerror(errno));
+		}
+		if (n == 0)
+			break;
+		buf.len += n;
+	}
+	close(fd);
+
+	/* no exit status if compare failed */
+	end = memrchr(buf.data, '\0', buf.len);
+	if (end != NULL) {
+		len = end - buf.data;
+		buffer_putc(&buf, '\0');
+		ret = atoi(buf.data + len + 1);
+		buf.len = len;
+	}
+	fwrite(buf.data, 1, buf.len, stdout);
+	buffer_free(&buf);
+
+	return ret;
+}
+
+int serve(int argc, char **argv)
+{
+	bool hide_kabi = false, hide_kabi_new = false;
+	struct sockaddr_un addr;
+	char *path, *server = NULL;
+	int opt, opt_index, fd;
+	struct option loptions[] = {
+		{"help", no_argument, 0, 'h'},
+		{"hide-kabi", no_argument, 0, 'k'},
+		{"hide-kabi-new", no_argument, 0, 'n'},
+		{"connect", required_argument, 0, 'c'},
+		{0, 0, 0, 0}
+	};
+
+	while ((opt = getopt_long(argc, argv, "+hknc:",
+				  loptions, &opt_index)) != -1) {
+		switch (opt) {
+		case 'n':
+			hide_kabi_new = true;
+			/* fall through */
+		case 'k':
+			hide_kabi = true;
+			break;
+		case 'c':
+			server = optarg;
+			break;
+		case 'h':
+		default:
+			serve_usage();
+		}
+	}
+
+	if (server != NULL)
+		return serve_client(server, argc - optind, argv + optind);
+
+	if (argc < optind + 2)
+		serve_usage();
+
+	path = argv[optind++];
+	while (optind < argc)
+		compare_load_baseline(argv[optind++], hide_kabi, hide_kabi_new);
+
+	/* the socket appears once the dumps are loaded */
+	fd = serve_socket(path, &addr);
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+		fail("Cannot bind to %s: %s\n", path, strerror(errno));
+	if (listen(fd, SOMAXCONN) < 0)
+		fail("Cannot listen on %s: %s\n", path, strerror(errno));
+
+	serve_loop(fd);
+
+	return 0;
+}
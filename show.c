@@ -20,12 +20,13 @@
 #include <unistd.h>
 #include "objects.h"
 #include "utils.h"
+#include "archive.h"
 
 struct {
 	bool debug;
 	bool hide_kabi;
 	bool hide_kabi_new;
-	FILE *file;
+	struct archive *archive; /* read the files from this archive */
 } show_config = {false, false, false, NULL};
 
 static void show_usage()
@@ -34,6 +35,8 @@ static void show_usage()
 	       "\tshow [options] kabi_file...\n"
 	       "\nOptions:\n"
 	       "    -h, --help:\t\tshow this message\n"
+	       "    -a, --archive archive:\n\t\t\t"
+	       "read the kabi files from an archive written by generate\n"
 	       "    -k, --hide-kabi:\thide changes made by RH_KABI_REPLACE()\n"
 	       "    -n, --hide-kabi-new:\n\t\t\thide the kabi trickery made by"
 	       " RH_KABI_REPLACE, but show the new field\n"
@@ -55,13 +58,14 @@ int show(int argc, char **argv)
 		{"hide-kabi", no_argument, 0, 'k'},
 		{"hide-kabi-new", no_argument, 0, 'n'},
 		{"help", no_argument, 0, 'h'},
+		{"archive", required_argument, 0, 'a'},
 		{"no-offset", no_argument, &display_options.no_offset, 1},
 		{0, 0, 0, 0}
 	};
 
 	memset(&display_options, 0, sizeof(display_options));
 
-	while ((opt = getopt_long(argc, argv, "dknh",
+	while ((opt = getopt_long(argc, argv, "dknha:",
 				  loptions, &opt_index)) != -1) {
 		switch (opt) {
 		case 0:
@@ -75,6 +79,9 @@ int show(int argc, char **argv)
 		case 'k':
 			show_config.hide_kabi = true;
 			break;
+		case 'a':
+			show_config.archive = archive_open(optarg);
+			break;
 		case 'h':
 		default:
 			show_usage();
@@ -86,10 +93,13 @@ int show(int argc, char **argv)
 
 	while (optind < argc) {
 		char *fn = argv[optind++];
+		struct kabi_data data;
+		char *path;
 
-		show_config.file = safe_fopen(fn);
+		if (!kabi_load(NULL, show_config.archive, fn, &data, &path))
+			fail("Failed to open kABI file: %s\n", path);
 
-		root = obj_parse(show_config.file, fn);
+		root = obj_parse(data.data, data.len, path);
 
 		if (show_config.hide_kabi)
 			obj_hide_kabi(root, show_config.hide_kabi_new);
@@ -102,8 +112,12 @@ int show(int argc, char **argv)
 			putchar('\n');
 
 		obj_free(root);
-		fclose(show_config.file);
+		kabi_unload(&data);
+		free(path);
 	}
 
+	if (show_config.archive != NULL)
+		archive_close(show_config.archive);
+
 	return ret;
 }
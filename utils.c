@@ -20,6 +20,8 @@
  */
 
 #include <sys/types.h>
+#include <sys/syscall.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -30,100 +32,428 @@
 #include <dirent.h>
 #include <assert.h>
 #include <libgen.h> /* dirname() */
+#include <fcntl.h>
+#include <pthread.h>
 
 #include "main.h"
 #include "utils.h"
 #include "hash.h"
 
+/* Where fail() returns to in a call of the library, NULL otherwise */
+__thread jmp_buf *fail_jmp;
+
+/* The message of the last failure, in a call of the library */
+static __thread char fail_buf[1024];
+
+void fail_exit(const char *func, int line, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	if (fail_jmp == NULL) {
+		fprintf(stderr, "%s():%d ", func, line);
+		vfprintf(stderr, fmt, args);
+		exit(1);
+	}
+
+	/* nothing is allocated: the failure may be a failed malloc() */
+	len = snprintf(fail_buf, sizeof(fail_buf), "%s():%d ", func, line);
+	if (len >= 0 && (size_t)len < sizeof(fail_buf))
+		vsnprintf(fail_buf + len, sizeof(fail_buf) - len, fmt, args);
+	va_end(args);
+
+	longjmp(*fail_jmp, 1);
+}
+
+const char *fail_message(void)
+{
+	return fail_buf;
+}
+
 /*
- * Sort function for scandir.
- * Walk regular file first, then process subdirectories.
+ * Directory walk
+ *
+ * The directories are listed with getdents64() by a pool of threads, ahead
+ * of walk_dir() which calls cb() on their entries in order. The types given
+ * by getdents64() spare an lstat() per entry. In each directory, the
+ * regular files come first, then the subdirectories, both sorted by byte
+ * value: the order does not depend on the locale and is the order of
+ * archive_name_cmp().
+ *
+ * The listings don't call fail(), which would leave the threads running on
+ * the stack of walk_dir(): their errors are reported in the nodes.
  */
-int reg_first(const struct dirent **a, const struct dirent **b)
+#define WALK_THREADS 4
+#define WALK_BUF_SIZE (64 * 1024)
+
+struct walk_dirent {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+struct walk_node {
+	char *path;
+	const char *name;		/* in the parent directory */
+	int err;			/* errno of the listing */
+	bool listed;
+	char **files;			/* regular files, sorted */
+	unsigned int nfiles;
+	struct walk_node **dirs;	/* subdirectories, sorted */
+	unsigned int ndirs;
+	char *names;			/* storage of the names */
+	struct walk_node *next;		/* in the stack of ctx->todo */
+};
+
+struct walk_ctx {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;		/* a node is pushed or listed */
+	struct walk_node *todo;		/* stack of the unlisted nodes */
+	bool stop;
+	char *buf;			/* for the listings of the walker */
+};
+
+/* Returns NULL if out of memory */
+static struct walk_node *walk_node_new(char *path, const char *name)
+{
+	struct walk_node *node = calloc(1, sizeof(*node));
+
+	if (node == NULL)
+		return NULL;
+	node->path = path;
+	node->name = name;
+
+	return node;
+}
+
+static void walk_node_free(struct walk_node *node)
+{
+	unsigned int i;
+
+	for (i = 0; i < node->ndirs; i++)
+		walk_node_free(node->dirs[i]);
+	free(node->dirs);
+	free(node->files);
+	free(node->names);
+	free(node->path);
+	free(node);
+}
+
+static int walk_name_cmp(const void *a, const void *b)
 {
-	if ((*a)->d_type == DT_REG && (*b)->d_type != DT_REG)
-		return -1;
-	if ((*b)->d_type == DT_REG && (*a)->d_type != DT_REG)
-		return 1;
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
 
-	/*
-	 * Backup to default collation
-	 * Note: the behavior depends on LC_COLLATE
-	 */
-	return alphasort(a, b);
+static int walk_node_cmp(const void *a, const void *b)
+{
+	return strcmp((*(struct walk_node * const *)a)->name,
+		      (*(struct walk_node * const *)b)->name);
+}
+
+/* Type of the entry, from lstat() if getdents64() does not tell */
+static unsigned char walk_type(int fd, struct walk_dirent *d)
+{
+	struct stat st;
+
+	if (d->d_type != DT_UNKNOWN)
+		return d->d_type;
+
+	if (fstatat(fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+		return DT_UNKNOWN;
+	if (S_ISREG(st.st_mode))
+		return DT_REG;
+	if (S_ISDIR(st.st_mode))
+		return DT_DIR;
+
+	return DT_UNKNOWN;
 }
 
 /*
- * Call cb() on all nodes in the directory structure @path.
- * If list_dirs == true run cb() on subdirectories as well, otherwise list only
- * files.
- * The cb() has to return true if we continue directory walk or false if we're
- * all done.
+ * Read the entries of the directory. The names are first stored as
+ * offsets in node->names, which moves as it grows. The regular files get
+ * an offset, the subdirectories the complement of theirs.
  */
-void walk_dir(char *path, bool list_dirs, walk_rv_t (*cb)(char *, void *),
-		void *arg)
+static void walk_read(struct walk_node *node, char *buf, long **offsets,
+		      unsigned int *count)
 {
-	struct dirent **entlist;
-	walk_rv_t cb_rv = WALK_CONT;
-	int entries, i;
+	size_t len = 0, size = 0;
+	unsigned int osize = 0;
+	long n, pos;
+	void *p;
+	int fd;
+
+	fd = open(node->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) {
+		node->err = errno;
+		return;
+	}
 
-	assert(path != NULL && strlen(path) >= 1);
+	while ((n = syscall(SYS_getdents64, fd, buf, WALK_BUF_SIZE)) > 0) {
+		for (pos = 0; pos < n; ) {
+			struct walk_dirent *d = (void *)(buf + pos);
+			size_t namelen = strlen(d->d_name);
+			unsigned char type;
+
+			pos += d->d_reclen;
+			if (strcmp(d->d_name, ".") == 0 ||
+			    strcmp(d->d_name, "..") == 0)
+				continue;
+
+			/* the symlinks are ignored */
+			type = walk_type(fd, d);
+			if (type != DT_REG && type != DT_DIR)
+				continue;
+
+			if (len + namelen + 1 > size) {
+				size = (size + namelen + 1) * 2;
+				p = realloc(node->names, size);
+				if (p == NULL)
+					goto nomem;
+				node->names = p;
+			}
+			memcpy(node->names + len, d->d_name, namelen + 1);
+
+			if (*count == osize) {
+				osize = osize ? osize * 2 : 64;
+				p = realloc(*offsets,
+					    osize * sizeof(**offsets));
+				if (p == NULL)
+					goto nomem;
+				*offsets = p;
+			}
+			(*offsets)[(*count)++] = type == DT_REG ? len : ~len;
+			len += namelen + 1;
+		}
+	}
+	if (n < 0)
+		node->err = errno;
+
+	close(fd);
+	return;
+nomem:
+	node->err = ENOMEM;
+	close(fd);
+}
 
-	entries = scandir(path, &entlist, NULL, reg_first);
-	if (entries == -1) {
-		fail("Failed to scan module directory %s: %s\n", path,
-		    strerror(errno));
+/* List the directory of node, and push its subdirectories to list */
+static void walk_list(struct walk_ctx *ctx, struct walk_node *node, char *buf)
+{
+	long *offsets = NULL;
+	unsigned int count = 0, i;
+	size_t plen = strlen(node->path);
+	const char *sep = node->path[plen - 1] == '/' ? "" : "/";
+
+	walk_read(node, buf, &offsets, &count);
+	if (node->err == 0 && count > 0) {
+		node->files = calloc(count, sizeof(*node->files));
+		node->dirs = calloc(count, sizeof(*node->dirs));
+		if (node->files == NULL || node->dirs == NULL)
+			node->err = ENOMEM;
+	}
+	for (i = 0; node->err == 0 && i < count; i++) {
+		struct walk_node *dir;
+		char *name, *path;
+
+		if (offsets[i] >= 0) {
+			node->files[node->nfiles++] = node->names + offsets[i];
+			continue;
+		}
+		name = node->names + ~offsets[i];
+		if (asprintf(&path, "%s%s%s", node->path, sep, name) < 0) {
+			node->err = ENOMEM;
+			break;
+		}
+		dir = walk_node_new(path, name);
+		if (dir == NULL) {
+			free(path);
+			node->err = ENOMEM;
+			break;
+		}
+		node->dirs[node->ndirs++] = dir;
+	}
+	free(offsets);
+
+	qsort(node->files, node->nfiles, sizeof(*node->files), walk_name_cmp);
+	qsort(node->dirs, node->ndirs, sizeof(*node->dirs), walk_node_cmp);
+
+	/* in reverse, so that they are listed in the walk order */
+	pthread_mutex_lock(&ctx->lock);
+	for (i = node->err == 0 ? node->ndirs : 0; i > 0; i--) {
+		node->dirs[i - 1]->next = ctx->todo;
+		ctx->todo = node->dirs[i - 1];
 	}
+	node->listed = true;
+	pthread_cond_broadcast(&ctx->cond);
+	pthread_mutex_unlock(&ctx->lock);
+}
+
+/* Called with ctx->lock held */
+static struct walk_node *walk_pop(struct walk_ctx *ctx)
+{
+	struct walk_node *node = ctx->todo;
+
+	if (node != NULL)
+		ctx->todo = node->next;
 
-	/* process all the files and directories within directory */
-	for (i = 0; i < entries; i++) {
-		struct dirent *ent = entlist[i];
-		struct stat entstat;
-		char *new_path;
+	return node;
+}
+
+static void *walk_worker(void *arg)
+{
+	struct walk_ctx *ctx = arg;
+	char *buf = malloc(WALK_BUF_SIZE);
+	struct walk_node *node;
+
+	/* walk_dir() lists the directories too */
+	if (buf == NULL)
+		return NULL;
 
-		if ((strcmp(ent->d_name, "..") == 0) ||
-		    (strcmp(ent->d_name, ".") == 0)) {
-			free(ent);
+	pthread_mutex_lock(&ctx->lock);
+	while (!ctx->stop) {
+		node = walk_pop(ctx);
+		if (node == NULL) {
+			pthread_cond_wait(&ctx->cond, &ctx->lock);
 			continue;
 		}
+		pthread_mutex_unlock(&ctx->lock);
+		walk_list(ctx, node, buf);
+		pthread_mutex_lock(&ctx->lock);
+	}
+	pthread_mutex_unlock(&ctx->lock);
 
-		if (path[strlen(path) - 1] == '/')
-			safe_asprintf(&new_path, "%s%s", path, ent->d_name);
-		else
-			safe_asprintf(&new_path, "%s/%s", path, ent->d_name);
+	free(buf);
 
-		if (lstat(new_path, &entstat) != 0) {
-			fail("Failed to stat directory %s: %s\n", new_path,
-			    strerror(errno));
+	return NULL;
+}
+
+/* Wait for node to be listed, listing the pending nodes meanwhile */
+static void walk_wait(struct walk_ctx *ctx, struct walk_node *node)
+{
+	struct walk_node *todo;
+
+	pthread_mutex_lock(&ctx->lock);
+	while (!node->listed) {
+		todo = walk_pop(ctx);
+		if (todo == NULL) {
+			pthread_cond_wait(&ctx->cond, &ctx->lock);
+			continue;
 		}
+		pthread_mutex_unlock(&ctx->lock);
+		walk_list(ctx, todo, ctx->buf);
+		pthread_mutex_lock(&ctx->lock);
+	}
+	pthread_mutex_unlock(&ctx->lock);
+}
 
-		if (S_ISDIR(entstat.st_mode)) {
-			if (list_dirs) {
-				cb_rv = cb(new_path, arg);
-				if (cb_rv != WALK_CONT)
-					goto out;
-			}
+static walk_rv_t walk_node(struct walk_ctx *ctx, struct walk_node *node,
+			   bool list_dirs, walk_rv_t (*cb)(char *, void *),
+			   void *arg)
+{
+	size_t plen = strlen(node->path);
+	const char *sep = node->path[plen - 1] == '/' ? "" : "/";
+	walk_rv_t rv;
+	unsigned int i;
+
+	walk_wait(ctx, node);
+	if (node->err != 0)
+		fail("Failed to scan module directory %s: %s\n", node->path,
+		     strerror(node->err));
+
+	for (i = 0; i < node->nfiles; i++) {
+		char *path;
+
+		safe_asprintf(&path, "%s%s%s", node->path, sep,
+			      node->files[i]);
+		rv = cb(path, arg);
+		free(path);
+
+		if (rv == WALK_STOP)
+			return WALK_STOP;
+		if (rv == WALK_SKIP)
+			return WALK_CONT;
+	}
 
-			/* Ignore symlinks */
-			if (!S_ISLNK(entstat.st_mode))
-				walk_dir(new_path, list_dirs, cb, arg);
-		} else if (S_ISREG(entstat.st_mode)) {
-			cb_rv = cb(new_path, arg);
+	for (i = 0; i < node->ndirs; i++) {
+		if (list_dirs) {
+			rv = cb(node->dirs[i]->path, arg);
+			if (rv == WALK_STOP)
+				return WALK_STOP;
+			if (rv == WALK_SKIP)
+				return WALK_CONT;
 		}
 
-out:
-		free(new_path);
-		free(ent);
+		if (walk_node(ctx, node->dirs[i], list_dirs, cb, arg) ==
+		    WALK_STOP)
+			return WALK_STOP;
+	}
 
-		if (cb_rv == WALK_STOP)
-			break;
-		if (cb_rv == WALK_SKIP) {
-			cb_rv = WALK_CONT;
+	return WALK_CONT;
+}
+
+/*
+ * Call cb() on all nodes in the directory structure @path.
+ * If list_dirs == true run cb() on subdirectories as well, otherwise list only
+ * files.
+ * The cb() returns WALK_CONT to continue, WALK_SKIP to skip the rest of the
+ * current directory or WALK_STOP if we're all done. The path given to cb()
+ * is only valid during the call.
+ * In a call of the library, a failure of the walk or of cb() returns from
+ * walk_dir() once the listing threads are joined.
+ */
+void walk_dir(char *path, bool list_dirs, walk_rv_t (*cb)(char *, void *),
+		void *arg)
+{
+	struct walk_ctx ctx = { .todo = NULL, .stop = false };
+	pthread_t threads[WALK_THREADS];
+	jmp_buf jmp, *outer = fail_jmp;
+	struct walk_node *root;
+	unsigned int started, t;
+	volatile bool failed = false;
+
+	assert(path != NULL && strlen(path) >= 1);
+
+	root = walk_node_new(safe_strdup(path), NULL);
+	if (root == NULL)
+		fail("Malloc of size %zu failed", sizeof(*root));
+	ctx.buf = safe_zmalloc(WALK_BUF_SIZE);
+	pthread_mutex_init(&ctx.lock, NULL);
+	pthread_cond_init(&ctx.cond, NULL);
+
+	ctx.todo = root;
+	for (started = 0; started < WALK_THREADS; started++) {
+		if (pthread_create(&threads[started], NULL, walk_worker,
+				   &ctx) != 0)
 			break;
-		}
 	}
 
-	free(entlist);
+	/* outside of the library, fail() exits with the threads running */
+	if (outer != NULL) {
+		fail_jmp = &jmp;
+		if (setjmp(jmp) != 0)
+			failed = true;
+	}
+	if (!failed)
+		walk_node(&ctx, root, list_dirs, cb, arg);
+	fail_jmp = outer;
+
+	pthread_mutex_lock(&ctx.lock);
+	ctx.stop = true;
+	pthread_cond_broadcast(&ctx.cond);
+	pthread_mutex_unlock(&ctx.lock);
+	for (t = 0; t < started; t++)
+		pthread_join(threads[t], NULL);
+
+	walk_node_free(root);
+	free(ctx.buf);
+	pthread_cond_destroy(&ctx.cond);
+	pthread_mutex_destroy(&ctx.lock);
+
+	/* fail_message() still holds the failure */
+	if (failed)
+		longjmp(*outer, 1);
 }
 
 int check_is_directory(char *dir)
@@ -412,6 +742,26 @@ char *filenametosymbol(const char *filename)
 	return name;
 }
 
+/*
+ * Is the kabi file (or record key) the one of an exported symbol, as
+ * opposed to a type?
+ */
+bool is_symbol_file(const char *filename)
+{
+	static const char *prefixes[] = {
+		FUNC_FILE, VAR_FILE, "asm--", "weak--",
+	};
+	const char *base = basename((char *)filename);
+	unsigned int i;
+
+	for (i = 0; i < sizeof(prefixes) / sizeof(*prefixes); i++) {
+		if (strncmp(base, prefixes[i], strlen(prefixes[i])) == 0)
+			return true;
+	}
+
+	return false;
+}
+
 struct hash *global_string_keeper;
 
 void global_string_keeper_init(void)
@@ -419,8 +769,13 @@ void global_string_keeper_init(void)
 	global_string_keeper = hash_new(1 << 20, free);
 }
 
+/* The types of the kabi files, see global_type_get() */
+static struct hash *global_types;
+
 void global_string_keeper_free(void)
 {
+	hash_free(global_types);
+	global_types = NULL;
 	hash_free(global_string_keeper);
 }
 
@@ -451,9 +806,52 @@ const char *global_string_get_move(char *string)
 	if (result == NULL) {
 		result = string;
 		hash_add(global_string_keeper, result, result);
-	} else {
+	} else if (result != string) {
+		/* string may already be the kept copy */
 		free(string);
 	}
 
 	return result;
 }
+
+/* Same as global_string_get_copy() for the len first bytes of string */
+const char *global_string_get_n(const char *string, size_t len)
+{
+	char *result;
+
+	result = hash_find_bin(global_string_keeper, string, len);
+	if (result == NULL) {
+		result = safe_zmalloc(len + 1);
+		memcpy(result, string, len);
+		hash_add(global_string_keeper, result, result);
+	}
+
+	return result;
+}
+
+/*
+ * The type of a kabi file, as filenametotype() gives it, interned: the
+ * types of two files are equal when their pointers are. It is only
+ * computed the first time.
+ */
+const char *global_type_get(const char *filename)
+{
+	const char *type;
+
+	if (global_types == NULL) {
+		global_types = hash_new(1 << 12, NULL);
+		if (global_types == NULL)
+			fail("Cannot create the kabi file types hash\n");
+	}
+
+	type = hash_find(global_types, filename);
+	if (type != NULL)
+		return type;
+
+	filename = global_string_get_copy(filename);
+	type = global_string_get_move(filenametotype(filename));
+	if (hash_add(global_types, filename, type) < 0)
+		fail("Cannot add '%s' to the kabi file types\n", filename);
+
+	return type;
+}
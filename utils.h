@@ -23,6 +23,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <errno.h>
+#include <setjmp.h>
 
 /*
  * Changes to file format that keep backward compatibility call for
@@ -38,12 +39,19 @@
 #define FILEFMT_VERSION_STRING	\
 	_VERSION(FILEFMT_VERSION_MAJOR,FILEFMT_VERSION_MINOR)
 
+/*
+ * Report a fatal error. The command exits, unless the error happens in a
+ * call of the library: then the call returns it, see kabi-dw.h.
+ */
 #define	fail(fmt, ...)	{					\
-	fprintf(stderr, "%s():%d ", __func__, __LINE__);	\
-	fprintf(stderr, fmt, ## __VA_ARGS__);			\
-	exit(1);						\
+	fail_exit(__func__, __LINE__, fmt, ## __VA_ARGS__);	\
 }
 
+extern __thread jmp_buf *fail_jmp;
+extern void fail_exit(const char *func, int line, const char *fmt, ...)
+	__attribute__((noreturn, format(printf, 3, 4)));
+extern const char *fail_message(void);
+
 static inline void safe_asprintf(char **strp, const char *fmt, ...)
 {
 	va_list arglist;
@@ -154,10 +162,13 @@ extern void safe_rename(const char *, const char *);
 extern char *path_normalize(char *);
 extern char *filenametotype(const char *);
 extern char *filenametosymbol(const char *);
+extern bool is_symbol_file(const char *);
 
 extern void global_string_keeper_init(void);
 extern void global_string_keeper_free(void);
 extern const char *global_string_get_copy(const char *string);
 extern const char *global_string_get_move(char *string);
+extern const char *global_string_get_n(const char *string, size_t len);
+extern const char *global_type_get(const char *filename);
 
 #endif /* UTILS_H */